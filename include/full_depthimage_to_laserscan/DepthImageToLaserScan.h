@@ -37,15 +37,31 @@
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/LaserScan.h>
 #include <sensor_msgs/image_encodings.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <stereo_msgs/DisparityImage.h>
 #include <image_geometry/pinhole_camera_model.h>
 #include <full_depthimage_to_laserscan/depth_traits.h>
 #include <sstream>
+#include <cstring>
 //#include <limits.h>
 //#include <math.h>
 #include <cmath>
 //#include <algorithm>
 #include <full_depthimage_to_laserscan/clean_camera_model.h>
+#include <full_depthimage_to_laserscan/aligned_allocator.h>
+#include <full_depthimage_to_laserscan/perf_counters.h>
+#include <full_depthimage_to_laserscan/FloorEstimator.h>
+#include <full_depthimage_to_laserscan/image_rotation.h>
+#include <full_depthimage_to_laserscan/GeometryRegistry.h>
+#include <full_depthimage_to_laserscan/cloud_input.h>
+#include <full_depthimage_to_laserscan/WorkStealingPool.h>
 #include <boost/make_shared.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <boost/integer.hpp>
+#include <boost/iterator/permutation_iterator.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <ros/ros.h>
 
@@ -54,6 +70,11 @@
 namespace full_depthimage_to_laserscan
 { 
   
+  typedef std::vector<cv::Point2d> Polygon; ///< Polygon in the output frame (x forward, y left), in meters
+  
+  /**
+   * Type-erased buffer whose typed views start on a cache line (see AlignedAllocator).
+   */
   struct MultitypeVector
   {
     template <typename T>
@@ -65,37 +86,120 @@ namespace full_depthimage_to_laserscan
     template <typename T>
     operator T*()
     {
-      return reinterpret_cast<T*>(data.data());
+      return reinterpret_cast<T*>(assume_aligned(data.data()));
     }
     
     template <typename T>
     operator T*() const
     {
-      return reinterpret_cast<const T*>(data.data());
+      return reinterpret_cast<const T*>(assume_aligned(data.data()));
     }
     
   private:
-    std::vector<char> data;
+    AlignedVector<char> data;
+  };
+  
+  /**
+   * Data-quality counters of one converted frame.
+   * 
+   * Every pixel of the band (after row sub-sampling) is either invalid (no measurement), rejected by the
+   * floor/overhead limit of its row, rejected by range_min, or accepted.
+   */
+  struct ConversionStats
+  {
+    uint32_t pixels; ///< Pixels examined
+    uint32_t valid; ///< Pixels with a depth measurement
+    uint32_t accepted; ///< Valid pixels within both limits
+    uint32_t rejected_row_limits; ///< Valid pixels at or beyond the floor/overhead limit of their row
+    uint32_t rejected_min_depth; ///< Valid pixels within the row limit but closer than range_min
+    uint32_t beams; ///< Beams of the scan
+    uint32_t no_return_beams; ///< Beams without a return
+    uint32_t single_pixel_beams; ///< Beams whose return is backed by a single accepted pixel
+  };
+  
+  /**
+   * Tables that only depend on the calibration, size and encoding of the images (see GeometryRegistry).
+   */
+  struct GeometryTables
+  {
+    float angle_min,
+          angle_max;
+    
+    std::vector<uint16_t> indicies;
+    AlignedVector<float> range_ratios;
+    AlignedVector<uint32_t> range_ratios_q15; ///< range_ratios in Q15 fixed point, for the millimetre path
+    
+    int beam_taps; ///< Maximum number of columns feeding a single beam
+    AlignedVector<int32_t> beam_columns; ///< beam_taps rows of num_beams columns; beams with fewer columns repeat their last one, holes point to the sentinel column
+  };
+  
+  /**
+   * Floor/overhead limit tables; they depend on the geometry and on the floor/overhead limits and tilt.
+   */
+  struct LimitTables
+  {
+    sensor_msgs::ImageConstPtr limits; ///< Dense depth limit of each pixel, for visualization
+    MultitypeVector row_limits; ///< Depth limit of each image row
   };
   
   struct ConversionCache
   {
     float floor_dist, 
           overhead_dist,
-          angle_min,
-          angle_max,
+          tilt,
           range_min,
           range_max;
     
     int scan_height;
+    int min_support;
+    bool incremental;
+    bool quantize;
     
-    sensor_msgs::ImageConstPtr limits;
-    std::vector<uint16_t> indicies;
-    std::vector<float> range_ratios;
+    boost::shared_ptr<const GeometryTables> geometry; ///< Shared with other converters of the same camera
+    boost::shared_ptr<const LimitTables> limit_tables; ///< Shared with other converters of the same camera and limits
+    
+    mutable AlignedVector<float> column_ranges; ///< Range of each column, followed by a sentinel 'no return' column
+    mutable AlignedVector<uint16_t> column_ranges_mm; ///< Millimetre range of each column, followed by a sentinel 'no return' column
+    mutable const uint16_t* last_minima; ///< uint16 column minima of the last conversion, NULL if not available
+    
+    bool undistort;
+    int raw_offset; ///< First image row of the band covered by the raw_* tables
+    AlignedVector<int32_t> raw_beams; ///< Beam index of each raw (distorted) pixel in the band
+    AlignedVector<float> raw_ratios; ///< Range/depth ratio of each raw pixel in the band
+    MultitypeVector raw_max_depths; ///< Floor/overhead depth limit of each raw pixel in the band
+    MultitypeVector raw_min_depths; ///< range_min depth limit of each raw pixel in the band
+    
+    mutable bool incremental_valid; ///< False if the incremental state must be rebuilt from scratch
+    mutable int incremental_frames; ///< Frames converted since the last full refresh
+    mutable int incremental_row_stride; ///< Row stride the incremental state was computed with
+    mutable MultitypeVector incremental_depths; ///< Filtered depths of the band from which each strip was last computed
+    mutable MultitypeVector incremental_minima; ///< Column minima of each strip
+    
+    int safety_zones; ///< Number of protective zones in the safety tables
+    float safety_range; ///< range_max the safety tables were computed for
+    MultitypeVector safety_near; ///< Per zone and column: smallest depth at which the column's ray is inside the zone
+    MultitypeVector safety_far; ///< Per zone and column: largest depth at which the column's ray is inside the zone
     
-    MultitypeVector row_limits;
     MultitypeVector min_depth_limits;
     mutable MultitypeVector min_depths_buffer;
+    mutable MultitypeVector support_buffer; ///< min_support rows holding the smallest depths seen so far in each column
+    mutable AlignedVector<uint16_t> column_counts; ///< Valid, accepted and far-rejected pixels of each column (3 rows), when collecting statistics
+    mutable MultitypeVector mask_bits; ///< Accepted flags of the band when recording the obstacle mask, bit-packed by groups of rows (see mask_groups)
+    mutable AlignedVector<uint8_t> quantized_codes; ///< Scratch rows of the quantized kernel, quantized_stride bytes apart: block codes, block rows, best codes, range_min codes, row limit codes
+    int quantized_stride; ///< Length of a row of quantized_codes, a multiple of 64
+    
+    float disparity_ft; ///< Focal length * baseline the disparity tables were computed for (0 = invalid)
+    AlignedVector<float> disparity_row_limits; ///< Smallest disparity (farthest floor/overhead depth) kept in each row
+    AlignedVector<float> disparity_max_limits; ///< Largest disparity (range_min) kept in each column
+    
+    float grid_resolution,
+          grid_range;
+    int grid_size;
+    
+    std::vector<uint32_t> grid_beam_offsets; ///< Beam i traverses grid_cells[grid_beam_offsets[i]] to grid_cells[grid_beam_offsets[i+1]-1]
+    std::vector<uint32_t> grid_cells; ///< Grid cells traversed by each beam, in order of increasing range
+    std::vector<float> grid_cell_ranges; ///< Range at which the beam enters the corresponding cell
+    std::vector<float> grid_beam_extents; ///< Range at which each beam leaves the grid (or reaches range_max)
     
   };
 
@@ -105,6 +209,29 @@ namespace full_depthimage_to_laserscan
   public:
     DepthImageToLaserScan();
     ~DepthImageToLaserScan();
+    
+    /**
+     * Conversion kernels, selected with the approach argument of convert_msg.
+     * 
+     * All kernels except KERNEL_REFERENCE produce identical scans. The undistort and incremental modes have their own
+     * kernels and take precedence, and min_support > 1 always uses KERNEL_HALVING.
+     */
+    enum Kernel
+    {
+      KERNEL_AUTO = -1, ///< Time the candidate kernels on the first frames and keep the fastest
+      KERNEL_REFERENCE = 0, ///< Original per-pixel implementation without floor/overhead filtering, for validation
+      KERNEL_HALVING = 1, ///< Filters the band into a buffer, then reduces it by repeated (vectorized) halving
+      KERNEL_FUSED = 2, ///< Filters and reduces the band in a single pass without an intermediate buffer
+      KERNEL_THREADED = 3, ///< KERNEL_FUSED with the columns split among several threads
+      NUM_KERNELS = 4
+    };
+    
+    static const int AUTOTUNE_ROUNDS = 5; ///< Frames each candidate is timed on in KERNEL_AUTO mode
+    
+    /**
+     * Returns the name of a kernel, e.g. for logging.
+     */
+    static const char* kernel_name(const int kernel);
 
     /**
      * Converts the information in a depth image (sensor_msgs::Image) to a sensor_msgs::LaserScan.
@@ -121,6 +248,23 @@ namespace full_depthimage_to_laserscan
     sensor_msgs::LaserScanPtr convert_msg(const sensor_msgs::ImageConstPtr& depth_msg,
                                           const sensor_msgs::CameraInfoConstPtr& info_msg, int approach, sensor_msgs::ImageConstPtr& image);
     
+    /**
+     * Converts a depth frame whose pixels live outside of a sensor_msgs::Image, e.g. in a memory-mapped capture file
+     * (see DepthCaptureReader) or a pooled message buffer (see PooledImage), without copying them.
+     * 
+     * Same as convert_msg, except that the frame is only offered to the floor estimator if owner keeps the pixels
+     * alive after the call.
+     * 
+     * @param depth_msg Header, size, step and encoding of the frame; its data is not used and may be empty.
+     * @param depth_data The pixels of the frame (depth_msg->step bytes per row); only read during the call.
+     * @param owner Owner of the pixels, if they may be referenced after the call.
+     * 
+     */
+    sensor_msgs::LaserScanPtr convert_buffer(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* depth_data,
+                                             const sensor_msgs::CameraInfoConstPtr& info_msg, int approach, 
+                                             sensor_msgs::ImageConstPtr& image, 
+                                             const boost::shared_ptr<const void>& owner = boost::shared_ptr<const void>());
+    
     /**
      * Sets the scan time parameter.
      * 
@@ -170,6 +314,305 @@ namespace full_depthimage_to_laserscan
     
     void set_filtering_limits(const float floor_dist, const float overhead_dist);
     
+    /**
+     * Sets the downward pitch of the camera's optical axis, which the floor/overhead limits take into account.
+     * 
+     * @param tilt Downward tilt (in radians); 0 if the camera looks horizontally.
+     * 
+     */
+    void set_camera_tilt(const float tilt);
+    
+    /**
+     * Sets up the online estimation of the camera's height and tilt above the floor.
+     * 
+     * While enabled, a background FloorEstimator fits the floor plane to frames at up to rate per second, starting
+     * from floor_dist and the camera tilt. Whenever its smoothed estimate moves noticeably, the floor/overhead limits
+     * are rebuilt from it before the next frame, with the floor limit margin above the estimated floor. Only the
+     * per-row limit tables are recomputed; the conversion never waits for an estimate.
+     * 
+     * @param enabled True to estimate the floor plane.
+     * @param rate Maximum number of estimates per second.
+     * @param margin Height (in meters) of the floor limit above the estimated floor.
+     * 
+     */
+    void set_floor_estimation(const bool enabled, const double rate, const float margin);
+    
+    /**
+     * Returns the current estimate of the floor plane.
+     * 
+     * @param plane Output: camera height and tilt.
+     * @return False if floor estimation is disabled or no estimate is available yet.
+     * 
+     */
+    bool get_floor_estimate(FloorEstimator::Plane& plane) const;
+    
+    /**
+     * Sets the speckle rejection parameters.
+     * 
+     * Instead of the plain minimum, each column reports the min_support-th smallest filtered depth, so up to
+     * min_support-1 isolated noisy pixels cannot create a phantom obstacle. If the min_support smallest depths all lie
+     * within support_tolerance of the nearest one, the nearest depth is reported instead, since it is then backed by
+     * enough neighbouring pixels. The undistort kernel ignores it and reports the nearest pixel of each beam.
+     * 
+     * @param min_support Number of pixels required to support a range (1 = plain minimum).
+     * @param support_tolerance Depth tolerance (in meters) within which supporting pixels must lie.
+     * 
+     */
+    void set_speckle_filter(const int min_support, const float support_tolerance);
+    
+    /**
+     * Sets whether the input depth image is raw (unrectified).
+     * 
+     * When enabled, the lens distortion is undone inside the conversion: every pixel of the band is looked up in
+     * precomputed tables holding its rectified beam index, range ratio and floor/overhead/range_min limits, so no
+     * separate full-frame rectification is required.
+     * 
+     * @param undistort True if the depth image is raw and should be undistorted during the conversion.
+     * 
+     */
+    void set_undistort(const bool undistort);
+    
+    /**
+     * Sets the mounting rotation of the camera, for cameras mounted on their side (portrait) or upside down.
+     * 
+     * The scan is taken from the image as if it had been rotated clockwise by the given angle: the conversion tables
+     * are built for a virtual camera with the rotated intrinsics, and the band is reduced straight from the original
+     * buffer through a strided view. With 90 or 270 degrees each column of the rotated band is a contiguous run of an
+     * image row, so it is reduced along that row; no rotated copy of the frame is made. A rotated camera always uses
+     * the rotated kernel (split among threads with KERNEL_THREADED); undistort and the incremental conversion are not
+     * available and the image is treated as rectified.
+     * 
+     * @param rotation Clockwise rotation (0, 90, 180 or 270 degrees) that turns the image upright.
+     * 
+     */
+    void set_rotation(const int rotation);
+    
+    /**
+     * Sets the row sub-sampling used within the band.
+     * 
+     * Only every row_stride-th row of the band is converted. This trades vertical resolution of the obstacle check for
+     * conversion time, and is used to stay within a time budget when the CPU is saturated.
+     * 
+     * @param row_stride Distance (in rows) between consecutive rows that are converted (1 = every row).
+     * 
+     */
+    void set_row_stride(const int row_stride);
+    
+    /**
+     * Sets the parameters of the incremental conversion.
+     * 
+     * In incremental mode the band is split into column strips and only strips whose filtered depths changed by more
+     * than the tolerance since they were last computed are reprocessed; the others reuse their previous column minima.
+     * Only a rotating subset of the rows is compared in each frame, so a change confined to a few rows may be picked
+     * up up to INCREMENTAL_SAMPLE_INTERVAL-1 frames late. This saves most of the conversion time while the view is
+     * static (e.g. when parked or docking). Incremental mode is not combined with min_support > 1 or undistort; those
+     * fall back to the full conversion.
+     * 
+     * @param incremental True to enable the incremental conversion.
+     * @param tolerance Depth change (in meters) below which a pixel is considered unchanged.
+     * @param refresh Number of frames after which all strips are recomputed.
+     * 
+     */
+    void set_incremental(const bool incremental, const float tolerance, const int refresh);
+    
+    /**
+     * Sets whether the band is reduced in 8-bit log-quantized depths.
+     * 
+     * Obstacle avoidance only needs the nearest obstacle of each beam to within a few centimetres. In quantized mode
+     * every pixel of a float image is mapped to an 8-bit logarithmic code within [range_min, range_max] and the
+     * floor/overhead and range_min filter as well as the per-column minimum run on the codes, with four times as many
+     * lanes per vector. The reported range of each column is then computed exactly from the pixel with the smallest
+     * code, so only the choice of that pixel is approximate: the true nearest pixel is at most one code (about 2% of its
+     * depth with the default range limits) nearer, and pixels within one code of a limit are rejected.
+     * 
+     * uint16 images always use the exact kernels: they already fill twice as many lanes as floats, and mapping them to
+     * codes costs more than the narrower lanes save. The halving, fused and threaded kernels all run the quantized
+     * reduction (threaded splits it among threads); undistort, rotation, incremental and min_support > 1 take
+     * precedence and stay exact. Statistics aren't collected.
+     * 
+     * @param quantize True to enable the quantized reduction.
+     * 
+     */
+    void set_quantize(const bool quantize);
+    
+    /**
+     * Sets the protective zones checked for the safety stop.
+     * 
+     * Right after the reduction, the nearest obstacle of every column is tested against each zone, in order. The first
+     * zone containing at least min_columns obstacle columns is reported to the safety callback; checking stops as soon
+     * as a violation is confirmed. The reference and undistort kernels have no column minima; they check the zones after
+     * the ranges are assembled, with each column taking the range of its beam.
+     * 
+     * @param zones Protective polygons in the output frame, in order of priority. An empty list disables the check.
+     * @param min_columns Number of columns that must lie inside a zone to confirm a violation.
+     * 
+     */
+    void set_safety_zones(const std::vector<Polygon>& zones, const int min_columns);
+    
+    /**
+     * Sets the function that receives the result of the safety check.
+     * 
+     * The callback is invoked from within convert_msg as soon as the column minima are known, i.e. before the LaserScan
+     * is assembled. Its argument is the index of the first violated zone, or -1 if no zone is violated.
+     * 
+     * @param callback Function called with the safety state of every converted frame.
+     * 
+     */
+    void set_safety_callback(const boost::function<void (int)>& callback);
+    
+    static const int INCREMENTAL_STRIP_WIDTH = 64; ///< Number of columns in each strip of the incremental conversion
+    static const int INCREMENTAL_SAMPLE_INTERVAL = 4; ///< Rows between the rows of a strip compared in each frame
+    
+
+    /**
+     * Sets the geometry of the local occupancy grid.
+     * 
+     * The grid is square, centered on the origin of the output frame and aligned with its axes. Setting grid_size to 0
+     * disables the grid and releases its traversal tables.
+     * 
+     * @param grid_resolution Edge length of a cell (in meters).
+     * @param grid_size Number of cells along each edge of the grid.
+     * 
+     */
+    void set_grid_geometry(const float grid_resolution, const int grid_size);
+    
+    /**
+     * Returns true if the occupancy grid is enabled and its traversal tables are available.
+     */
+    bool grid_enabled() const;
+    
+    /**
+     * Converts a stereo disparity image directly to a sensor_msgs::LaserScan, without an intermediate depth image.
+     * 
+     * The floor/overhead and range_min limits are precomputed as disparity thresholds, each column is reduced to its
+     * largest valid disparity (the nearest point), and only that single value per column is turned into a depth.
+     * The undistort, incremental and min_support options don't apply to disparity input.
+     * 
+     * @param disparity_msg Disparity image (32FC1).
+     * @param info_msg CameraInfo of the (left) camera the disparity image is registered to.
+     * @return sensor_msgs::LaserScanPtr for the center row(s) of the disparity image.
+     * 
+     */
+    sensor_msgs::LaserScanPtr convert_disparity(const stereo_msgs::DisparityImageConstPtr& disparity_msg,
+                                                const sensor_msgs::CameraInfoConstPtr& info_msg);
+    
+    /**
+     * Converts an organized point cloud to a sensor_msgs::LaserScan, using the z of each point as the depth of its pixel.
+     * 
+     * The z field is filtered and reduced in place, with the same limit tables as a 32FC1 depth image of the size of
+     * the cloud, so the cloud is never converted to a depth image. Without a CameraInfo, the intrinsics are estimated
+     * from the points of the cloud (see estimate_camera_info) and kept until the size of the clouds changes; so are they
+     * if the CameraInfo has a different size than the cloud (e.g. that of another stream), with a warning. The
+     * kernel, rotation, undistort, incremental, quantize and min_support options don't apply to cloud input, and no
+     * statistics or obstacle mask are recorded.
+     * 
+     * @param cloud_msg Organized cloud in the optical frame of the camera (see CloudDepthView).
+     * @param info_msg CameraInfo of the camera, or NULL to estimate it. Ignored unless it has the size of the cloud.
+     * @return sensor_msgs::LaserScanPtr for the center row(s) of the cloud.
+     * 
+     */
+    sensor_msgs::LaserScanPtr convert_cloud(const sensor_msgs::PointCloud2ConstPtr& cloud_msg,
+                                            const sensor_msgs::CameraInfoConstPtr& info_msg);
+    
+    typedef boost::function<void (const std::vector<boost::function<void ()> >&)> ParallelExecutor;
+    
+    /**
+     * Lets KERNEL_THREADED run its column chunks on an external thread pool instead of its own threads.
+     * 
+     * @param executor Runs the given tasks in parallel and returns when all have finished; empty to use own threads.
+     * @param num_threads Number of chunks to split the columns into.
+     * 
+     */
+    void set_parallel_executor(const ParallelExecutor& executor, const int num_threads);
+    
+    /**
+     * Enables the per-frame data-quality counters (see ConversionStats).
+     * 
+     * The counters are accumulated by the halving, fused and threaded kernels in the same pass that filters the band.
+     * The reference kernel, the undistort and incremental modes and disparity input don't collect them.
+     * 
+     * @param collect True to collect the counters.
+     * 
+     */
+    void set_collect_stats(const bool collect);
+    
+    /**
+     * Returns the counters of the last conversion.
+     * 
+     * @param stats Output: the counters.
+     * @return False if the last conversion didn't collect counters.
+     * 
+     */
+    bool get_stats(ConversionStats& stats) const;
+    
+    /**
+     * Enables the obstacle mask, which records which pixels of the band were accepted as obstacles.
+     * 
+     * The halving, fused and threaded kernels store the result of the floor/overhead and range_min comparisons they
+     * already make, bit-packed per row, in the same pass that filters the band. The reference kernel, the rotated,
+     * undistort, incremental and quantized modes and disparity input don't record it.
+     * 
+     * @param collect True to record the mask.
+     * 
+     */
+    void set_collect_mask(const bool collect);
+    
+    /**
+     * Returns the obstacle mask of the last conversion as a mono8 image of the size of the depth image.
+     * 
+     * Accepted pixels are 255; all other pixels, including rows of the band skipped by the row stride and rows outside
+     * of the band, are 0.
+     * 
+     * @param mask Output: the mask, with the header of the depth image.
+     * @return False if the last conversion didn't record a mask.
+     * 
+     */
+    bool get_obstacle_mask(sensor_msgs::Image& mask) const;
+    
+    /**
+     * Enables profiling with hardware performance counters.
+     * 
+     * Cycles, instructions, LLC misses and branch misses are counted around the cache update, the conversion kernel
+     * and the assembly of the ranges, and the averages (cycles/pixel, misses/frame) are logged every
+     * PerfProfiler::REPORT_FRAMES frames. Requires a build with -DPERF_COUNTERS=ON; otherwise only a warning is logged.
+     * 
+     * @param profiling True to enable profiling.
+     * 
+     */
+    void set_profiling(const bool profiling);
+    
+    /**
+     * Returns the kernel that KERNEL_AUTO settled on, or KERNEL_AUTO while the candidates are still being timed.
+     * 
+     * Autotuning restarts whenever the resolution, encoding or band size of the input changes.
+     */
+    int tuned_kernel() const;
+    
+    /**
+     * Quantizes the ranges of a LaserScan produced by convert_msg to millimetres.
+     * 
+     * For uint16 images converted without undistortion, the ranges are computed directly from the column minima of
+     * the conversion with fixed-point range ratios, without going through float. Otherwise the float ranges of the
+     * scan are rounded.
+     * 
+     * @param scan_msg LaserScan returned by the most recent call to convert_msg.
+     * @param ranges_mm Output: range of each beam in millimetres; 0 means no return.
+     * 
+     */
+    void compact_ranges(const sensor_msgs::LaserScan& scan_msg, std::vector<uint16_t>& ranges_mm) const;
+    
+    /**
+     * Rasterizes a LaserScan produced by convert_msg into a robot-centered occupancy grid.
+     * 
+     * Each beam walks its precomputed cell traversal table: cells passed before the measured range are marked free and
+     * the cell containing the return is marked occupied (unless the return is at range_max). Beams without a valid
+     * return leave their cells unknown.
+     * 
+     * @param scan_msg LaserScan returned by the most recent call to convert_msg.
+     * @param grid The output occupancy grid.
+     * 
+     */
+    void convert_grid(const sensor_msgs::LaserScan& scan_msg, nav_msgs::OccupancyGrid& grid) const;
 
     void updateCache();
     
@@ -216,21 +659,43 @@ namespace full_depthimage_to_laserscan
     
     void updateCache(const sensor_msgs::ImageConstPtr& depth_msg, const sensor_msgs::CameraInfoConstPtr& info_msg);
     
+    /**
+     * Returns the calibration of the virtual upright camera for info_msg, derived again only if it changed.
+     */
+    sensor_msgs::CameraInfoConstPtr rotated_camera_info(const sensor_msgs::CameraInfoConstPtr& info_msg);
+    
     
+    /**
+     * Fetches the geometry tables of the current calibration from the GeometryRegistry; they are only built if no other
+     * converter of the same camera has built them yet.
+     */
     void update_mapping(const sensor_msgs::ImageConstPtr& depth_msg)
     {
+      std::string key = GeometryRegistry::calibration_key(cam_model_.cameraInfo(), *depth_msg);
+      cache_.geometry = GeometryRegistry::instance().geometry(key, boost::bind(&DepthImageToLaserScan::build_geometry,
+                                                                               this, depth_msg));
+      
+      // Per-column range buffers, followed by the sentinel 'no return' column
+      cache_.column_ranges.assign(depth_msg->width + 1, std::numeric_limits<float>::infinity());
+      cache_.column_ranges_mm.assign(depth_msg->width + 1, std::numeric_limits<uint16_t>::max());
+    }
+    
+    boost::shared_ptr<GeometryTables> build_geometry(const sensor_msgs::ImageConstPtr& depth_msg) const
+    {
+      boost::shared_ptr<GeometryTables> geometry = boost::make_shared<GeometryTables>();
       if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1)
       {
-        update_mapping<uint16_t>(depth_msg);
+        build_mapping<uint16_t>(depth_msg, *geometry);
       }
       else if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_32FC1)
       {
-        update_mapping<float>(depth_msg);
+        build_mapping<float>(depth_msg, *geometry);
       }
+      return geometry;
     }
     
     template <typename T>
-    void update_mapping(const sensor_msgs::ImageConstPtr& depth_msg)
+    void build_mapping(const sensor_msgs::ImageConstPtr& depth_msg, GeometryTables& geometry) const
     {
       // Calculate angle_min and angle_max by measuring angles between the left ray, right ray, and optical center ray
       cv::Point2d raw_pixel_left(0, cam_model_.cy());
@@ -248,10 +713,11 @@ namespace full_depthimage_to_laserscan
       double angle_max = angle_between_rays(left_ray, center_ray);
       double angle_min = -angle_between_rays(center_ray, right_ray); // Negative because the laserscan message expects an opposite rotation of that from the depth image
       
-      cache_.angle_min=angle_min;
-      cache_.angle_max=angle_max;
+      geometry.angle_min=angle_min;
+      geometry.angle_max=angle_max;
       
-      double angle_increment = (angle_max - angle_min) / (depth_msg->width - 1);
+      // Use the angles as stored in the tables (and the LaserScan) so that the first/last columns land on the first/last beams
+      double angle_increment = (geometry.angle_max - geometry.angle_min) / (depth_msg->width - 1);
       
       
       float center_x = cam_model_.cx();
@@ -262,21 +728,24 @@ namespace full_depthimage_to_laserscan
       float constant_x = unit_scaling / cam_model_.fx();
       float constant_y = unit_scaling / cam_model_.fy();
       
-      cache_.indicies.resize(depth_msg->width);
+      geometry.indicies.resize(depth_msg->width);
       
       //ROS_INFO_STREAM("center_x=" << center_x << ", constant_x=" << constant_x << ", unit_scaling=" << unit_scaling);
       for(int u = 0; u < depth_msg->width; ++u)
       {
         double th = -atan2((double)(u - center_x) * constant_x, unit_scaling); // Atan2(x, z), but depth divides out
-        int index = (th - angle_min) / angle_increment;
+        int index = (th - geometry.angle_min) / angle_increment;
         
         //ROS_INFO_STREAM("u=" << u << ", th=" << th << ", index=" << index);
         
-        cache_.indicies[u] = index;
+        geometry.indicies[u] = std::min(std::max(index, 0), (int)depth_msg->width - 1);
       }
       
+      update_beam_columns(geometry, depth_msg->width);
       
-      cache_.range_ratios.resize(depth_msg->width);
+      
+      geometry.range_ratios.resize(depth_msg->width);
+      geometry.range_ratios_q15.resize(depth_msg->width);
       
       for(int u = 0; u < depth_msg->width; ++u)
       {
@@ -286,13 +755,70 @@ namespace full_depthimage_to_laserscan
         
         cv::Point3f world_pnt = cam_model_.projectPixelTo3dRay(pt);
         float ratio = std::sqrt(world_pnt.x*world_pnt.x + 1); //making use of the fact that z=1 and y is irrelevant
-        cache_.range_ratios[u] = ratio;
+        geometry.range_ratios[u] = ratio;
+        geometry.range_ratios_q15[u] = (uint32_t)(ratio * (1 << 15) + 0.5f);
         //ROS_INFO_STREAM("u=" << u << ", ratio=" << ratio);
         
       }
       
     }
     
+    /**
+     * Builds the per-beam cell traversal tables of the occupancy grid.
+     * 
+     * Each beam is traced once through the grid with an exact voxel traversal (Amanatides & Woo), recording every cell
+     * it enters up to range_max together with the range at which it enters it.
+     */
+    void update_grid(const sensor_msgs::ImageConstPtr& depth_msg);
+    
+    /**
+     * Converts the depth limits of the float tables to disparity thresholds for the given focal length * baseline.
+     */
+    void update_disparity_tables(const float focal_baseline);
+    
+    /**
+     * Reduces the band of a disparity image to the nearest depth of each column and assembles the scan from them.
+     */
+    void convert_disparity_band(const sensor_msgs::Image& disparity, const float focal_baseline, 
+                                const sensor_msgs::LaserScanPtr& scan_msg) const;
+    
+    /**
+     * Reduces the band of a point cloud to the nearest accepted depth of each column, like the fused kernel, reading
+     * the depths col_step floats apart. COL_STEP fixes the step at compile time for the common point layouts, so that
+     * the strided loads are vectorized; 0 uses col_step.
+     */
+    template<int COL_STEP>
+    void reduce_cloud_band(const float* depth_row, const int col_step, const int row_step, const float* limits_row, 
+                           const int num_rows, const int row_stride, const int ranges_size, const float big_val, 
+                           const float* min_depth_limits, float* min_depths) const
+    {
+      const int step = COL_STEP ? COL_STEP : col_step;
+      std::fill(min_depths, min_depths + ranges_size, big_val);
+      
+      const float* source = depth_row;
+      for(int v = 0; v < num_rows; ++v, source += row_stride*row_step)
+      {
+        float safe_min = limits_row[v*row_stride];
+        for(int u = 0; u < ranges_size; ++u)
+        {
+          float depth = source[u*step];
+          bool accepted = (depth < safe_min) & (min_depth_limits[u] < depth); // Not &&, which keeps the strided loop from vectorizing
+          float filtered_depth = accepted ? depth : big_val;
+          min_depths[u] = mymin(min_depths[u], filtered_depth);
+        }
+      }
+    }
+    
+    /**
+     * Reduces the band of a point cloud to the nearest depth of each column and assembles the scan from them.
+     */
+    void convert_cloud_band(const CloudDepthView& view, const sensor_msgs::LaserScanPtr& scan_msg) const;
+    
+    /**
+     * Inverts the column->beam mapping in geometry.indicies into the gather tables used by assemble_beams.
+     */
+    void update_beam_columns(GeometryTables& geometry, const int num_columns) const;
+    
     void update_min_range(const sensor_msgs::ImageConstPtr& depth_msg)
     {
       if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1)
@@ -314,103 +840,348 @@ namespace full_depthimage_to_laserscan
       T* min_depth_limits = cache_.min_depth_limits; //TODO
       for(int u = 0; u < depth_msg->width; ++u)
       {
-        float ratio = cache_.range_ratios[u];
+        float ratio = cache_.geometry->range_ratios[u];
         min_depth_limits[u] = min_range/ratio;
       }
       cache_.range_min = range_min_;
     }
     
-    void update_buffer(const sensor_msgs::ImageConstPtr& depth_msg)
+    void update_raw_tables(const sensor_msgs::ImageConstPtr& depth_msg)
     {
       if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1)
       {
-        update_buffer<uint16_t>(depth_msg);
+        update_raw_tables<uint16_t>(depth_msg);
       }
       else if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_32FC1)
       {
-        update_buffer<float>(depth_msg);
+        update_raw_tables<float>(depth_msg);
       }
-      cache_.scan_height = scan_height_;
+      cache_.undistort = undistort_;
     }
     
     template <typename T>
-    void update_buffer(const sensor_msgs::ImageConstPtr& depth_msg)
+    void update_raw_tables(const sensor_msgs::ImageConstPtr& depth_msg)
     {
-      cache_.min_depths_buffer.resize<T>(depth_msg->width*scan_height_); //TODO
+      int width = depth_msg->width;
+      int offset = (int)(cam_model_.cy()-scan_height_/2);
+      int num_pixels = undistort_ ? width*scan_height_ : 0;
+      
+      cache_.raw_offset = offset;
+      cache_.raw_beams.resize(num_pixels);
+      cache_.raw_ratios.resize(num_pixels);
+      cache_.raw_max_depths.resize<T>(num_pixels);
+      cache_.raw_min_depths.resize<T>(num_pixels);
+      
+      T* max_depths = cache_.raw_max_depths;
+      T* min_depths = cache_.raw_min_depths;
+      
+      double angle_increment = (cache_.geometry->angle_max - cache_.geometry->angle_min) / (width - 1);
+      float unit_scaling = DepthTraits<T>::fromMeters( T(1) );
+      float min_range = DepthTraits<T>::fromMeters(range_min_);
+      float largest = std::numeric_limits<T>::max();
+      
+      // Same mapping as update_mapping, but evaluated at the rectified location of each pixel
+      float center_x = cam_model_.cx();
+      double meters = DepthTraits<T>::toMeters( T(1) );
+      float constant_x = meters / cam_model_.fx();
+      
+      for(int v = offset, i = 0; v < offset + scan_height_ && num_pixels > 0; ++v)
+      {
+        for(int u = 0; u < width; ++u, ++i)
+        {
+          cv::Point2d raw_pixel(u, v);
+          cv::Point2d rect_pixel = cam_model_.rectifyPoint(raw_pixel);
+          cv::Point3f ray = cam_model_.projectPixelTo3dRay(rect_pixel);
+          
+          double th = -atan2((double)((float)rect_pixel.x - center_x) * constant_x, meters);
+          int index = (th - cache_.geometry->angle_min) / angle_increment;
+          cache_.raw_beams[i] = std::min(std::max(index, 0), width - 1);
+          
+          float ratio = std::sqrt(ray.x*ray.x + 1);
+          cache_.raw_ratios[i] = ratio;
+          min_depths[i] = min_range/ratio;
+          
+          float dist_ratio = limit_ratio(ray.y);
+          max_depths[i] = std::min(dist_ratio*unit_scaling, largest);
+        }
+      }
     }
     
-    void update_limits(const sensor_msgs::ImageConstPtr& depth_msg)
+    void update_safety(const sensor_msgs::ImageConstPtr& depth_msg)
     {
       if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1)
       {
-        update_limits<uint16_t>(depth_msg);
+        update_safety<uint16_t>(depth_msg);
       }
       else if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_32FC1)
       {
-        update_limits<float>(depth_msg);
+        update_safety<float>(depth_msg);
       }
     }
     
+    /**
+     * Computes, for every zone and column, the interval of depths over which the column's ray lies inside the zone.
+     * 
+     * A pixel of column u at depth z is at (z, -(u-cx)/fx * z) in the output frame, so the ray is intersected once with
+     * every polygon edge and the nearest inside interval is kept. This reduces the per-frame check to two comparisons
+     * per column and zone.
+     */
     template <typename T>
-    void update_limits(const sensor_msgs::ImageConstPtr& depth_msg)
+    void update_safety(const sensor_msgs::ImageConstPtr& depth_msg)
     {
-      sensor_msgs::ImagePtr new_msg_ptr = boost::make_shared<sensor_msgs::Image>();
-      
-      sensor_msgs::Image &new_msg = *new_msg_ptr;
-      new_msg.header = depth_msg->header;
-      new_msg.height = depth_msg->height;
-      new_msg.width = depth_msg->width;
-      new_msg.encoding = depth_msg->encoding;
-      new_msg.is_bigendian = false; //image->is_bigendian;
-      new_msg.step = depth_msg->step;
-      size_t size = new_msg.step * new_msg.height;
-      new_msg.data.resize(size);
-      
-      T* send_data = (T*)new_msg.data.data(); 
-      
-      float unit_scaling=DepthTraits<T>::fromMeters( T(1) );
-      
-      cache_.row_limits.resize<T>(depth_msg->height);
+      const int width = depth_msg->width;
+      const int num_zones = safety_zones_.size();
       
-      T* row_limits = cache_.row_limits;
+      cache_.safety_zones = num_zones;
+      cache_.safety_range = range_max_;
+      cache_.safety_near.resize<T>(num_zones*width);
+      cache_.safety_far.resize<T>(num_zones*width);
       
-      //float floor_dist=floor_dist_*unit_scaling;
-      //float overhead_dist=overhead_dist_*unit_scaling;
+      T* near = cache_.safety_near;
+      T* far = cache_.safety_far;
       
-      //TODO: Even though this is only used for visualization, perhaps it should only reflect the relevant region, as determined by 'scan_height_'?
-      //TODO: Generate the whole image only on demand?
-      for(int v=0,i=0; v< depth_msg->height; ++v)
+      for(int z = 0; z < num_zones; ++z)
       {
-        //Results should be the same along a row; dense limits only used for visualization purposes
-        for(int u=0; u<depth_msg->width; ++u,++i)
+        const Polygon& zone = safety_zones_[z];
+        const int num_vertices = zone.size();
+        
+        for(int u = 0; u < width; ++u, ++near, ++far)
         {
-          cv::Point2d pt;
-          pt.x = u;
-          pt.y = v;
+          // Direction of the column's ray in the output frame, parametrized by depth
+          double slope = -(u - cam_model_.cx()) / cam_model_.fx();
           
-          cv::Point3f world_pnt = cam_model_.projectPixelTo3dRay(pt);
-          float ratio;
-          if(world_pnt.y>0)
+          std::vector<double> crossings(1, 0.0);
+          for(int i = 0; i < num_vertices; ++i)
           {
-            ratio=floor_dist_/world_pnt.y;
-          }
-          else
-          {
-            ratio=-overhead_dist_/world_pnt.y;
+            const cv::Point2d& a = zone[i];
+            const cv::Point2d& b = zone[(i+1) % num_vertices];
+            
+            // Solve d*(1,slope) = a + t*(b-a) for d and t
+            double ex = b.x - a.x, ey = b.y - a.y;
+            double det = ex*slope - ey;
+            if(det == 0)
+            {
+              continue;
+            }
+            double d = (ex*a.y - ey*a.x) / det;
+            double t = (a.y - slope*a.x) / det;
+            if(d > 0 && t >= 0 && t <= 1)
+            {
+              crossings.push_back(d);
+            }
           }
-          //NOTE: Low priority optimizations: world_pnt.z is always 1, and could precompute unit_scaling/floor_dist_
-          float z = world_pnt.z*ratio*unit_scaling; 
-          //TODO: add check for out of range number for 16U, convert to 0?
-          //ROS_INFO_STREAM("[" << u << "," << v << "]: ratio=" << ratio << ", z=" << z);
+          std::sort(crossings.begin(), crossings.end());
           
-          send_data[i] = z;
+          // Depths beyond range_max never hold obstacles; clamping also keeps the limits representable
+          *near = std::numeric_limits<T>::max();
+          *far = 0;
+          for(size_t c = 0; c + 1 < crossings.size(); ++c)
+          {
+            double begin = crossings[c], end = crossings[c+1];
+            double mid = (begin + end) / 2;
+            if(begin < range_max_ && inside(zone, cv::Point2d(mid, slope*mid)))
+            {
+              *near = DepthTraits<T>::fromMeters(begin);
+              *far = DepthTraits<T>::fromMeters(std::min<double>(end, range_max_));
+              break;
+            }
+          }
         }
-        row_limits[v] = send_data[i-1];
       }
-      cache_.limits = (sensor_msgs::ImageConstPtr)new_msg_ptr;
-            
-      cache_.floor_dist = floor_dist_;
+    }
+    
+    /**
+     * Returns true if the point lies inside the polygon (even-odd rule).
+     */
+    static bool inside(const Polygon& polygon, const cv::Point2d& point);
+    
+    /**
+     * Checks the column minima against the protective zones and reports the result to the safety callback.
+     * 
+     * @param min_depths The reduced depth of each column.
+     * @param ranges_size Number of columns.
+     * @param cache The cache holding the safety tables.
+     * 
+     */
+    template<typename T>
+    void check_safety(const T* min_depths, const int ranges_size, const ConversionCache& cache) const
+    {
+      if(!safety_cb_)
+      {
+        return;
+      }
+      
+      const int CHUNK = 64;
+      const T* near = cache.safety_near;
+      const T* far = cache.safety_far;
+      
+      int violated = -1;
+      for(int z = 0; z < cache.safety_zones && violated < 0; ++z, near += ranges_size, far += ranges_size)
+      {
+        int violations = 0;
+        for(int start = 0; start < ranges_size && violations < safety_min_columns_; start += CHUNK)
+        {
+          const int end = std::min(start + CHUNK, ranges_size);
+          for(int u = start; u < end; ++u)
+          {
+            T depth = min_depths[u];
+            violations += (near[u] <= depth) & (depth <= far[u]);
+          }
+        }
+        if(violations >= safety_min_columns_)
+        {
+          violated = z;
+        }
+      }
+      
+      safety_cb_(violated);
+    }
+    
+    /**
+     * Checks the protective zones for the kernels that write the beam ranges directly (reference and undistort) and
+     * have no column minima: each column takes the depth at which its ray reaches the range of the beam it maps to.
+     * 
+     * @param scan_msg The LaserScan with the ranges of the frame.
+     * @param cache The cache holding the safety tables and the scratch buffer for the column depths.
+     * 
+     */
+    template<typename T>
+    void check_safety_ranges(const sensor_msgs::LaserScan& scan_msg, const ConversionCache& cache) const
+    {
+      if(!safety_cb_)
+      {
+        return;
+      }
+      
+      const int ranges_size = cache.geometry->indicies.size();
+      const uint16_t* beams = cache.geometry->indicies.data();
+      const float* range_ratios = assume_aligned(cache.geometry->range_ratios.data());
+      const float* ranges = scan_msg.ranges.data();
+      
+      const T big_val = DepthTraits<T>::fromMeters(range_max_+1);
+      const float no_return = std::numeric_limits<float>::infinity();
+      T* min_depths = cache.min_depths_buffer;
+      
+      for(int u = 0; u < ranges_size; ++u)
+      {
+        float range = ranges[beams[u]];
+        min_depths[u] = (range < no_return) ? (T)(DepthTraits<T>::fromMeters(range) / range_ratios[u]) : big_val; // Not NaN
+      }
+      
+      check_safety(static_cast<const T*>(min_depths), ranges_size, cache);
+    }
+    
+    void update_buffer(const sensor_msgs::ImageConstPtr& depth_msg)
+    {
+      if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1)
+      {
+        update_buffer<uint16_t>(depth_msg);
+      }
+      else if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_32FC1)
+      {
+        update_buffer<float>(depth_msg);
+      }
+      cache_.scan_height = scan_height_;
+      cache_.min_support = min_support_;
+    }
+    
+    template <typename T>
+    void update_buffer(const sensor_msgs::ImageConstPtr& depth_msg)
+    {
+      cache_.min_depths_buffer.resize<T>(depth_msg->width*scan_height_); //TODO
+      cache_.support_buffer.resize<T>(depth_msg->width*min_support_);
+      cache_.incremental_depths.resize<T>(incremental_ ? depth_msg->width*scan_height_ : 0);
+      cache_.incremental_minima.resize<T>(incremental_ ? depth_msg->width : 0);
+      cache_.incremental = incremental_;
+      
+      cache_.quantized_stride = (std::max((int)depth_msg->width, scan_height_) + 63) & ~63;
+      cache_.quantized_codes.resize(quantize_ ? 5*cache_.quantized_stride : 0);
+      cache_.quantize = quantize_;
+    }
+    
+    /**
+     * Fetches the limit tables of the current calibration and limits from the GeometryRegistry, building them if no
+     * other converter of the same camera uses the same limits.
+     */
+    void update_limits(const sensor_msgs::ImageConstPtr& depth_msg)
+    {
+      cache_.floor_dist = effective_floor_dist();
       cache_.overhead_dist = overhead_dist_;
+      cache_.tilt = effective_tilt();
+      
+      std::string key = GeometryRegistry::calibration_key(cam_model_.cameraInfo(), *depth_msg);
+      GeometryRegistry::append_key(key, cache_.floor_dist);
+      GeometryRegistry::append_key(key, cache_.overhead_dist);
+      GeometryRegistry::append_key(key, cache_.tilt);
+      cache_.limit_tables = GeometryRegistry::instance().limits(key, boost::bind(&DepthImageToLaserScan::build_limit_tables,
+                                                                                 this, depth_msg));
+    }
+    
+    boost::shared_ptr<LimitTables> build_limit_tables(const sensor_msgs::ImageConstPtr& depth_msg) const
+    {
+      boost::shared_ptr<LimitTables> tables = boost::make_shared<LimitTables>();
+      if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1)
+      {
+        build_limits<uint16_t>(depth_msg, *tables);
+      }
+      else if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_32FC1)
+      {
+        build_limits<float>(depth_msg, *tables);
+      }
+      return tables;
+    }
+    
+    template <typename T>
+    void build_limits(const sensor_msgs::ImageConstPtr& depth_msg, LimitTables& tables) const
+    {
+      sensor_msgs::ImagePtr new_msg_ptr = boost::make_shared<sensor_msgs::Image>();
+      
+      sensor_msgs::Image &new_msg = *new_msg_ptr;
+      new_msg.header = depth_msg->header;
+      new_msg.height = depth_msg->height;
+      new_msg.width = depth_msg->width;
+      new_msg.encoding = depth_msg->encoding;
+      new_msg.is_bigendian = false; //image->is_bigendian;
+      new_msg.step = depth_msg->step;
+      size_t size = new_msg.step * new_msg.height;
+      new_msg.data.resize(size);
+      
+      T* send_data = (T*)new_msg.data.data(); 
+      
+      float unit_scaling=DepthTraits<T>::fromMeters( T(1) );
+      
+      tables.row_limits.resize<T>(depth_msg->height);
+      
+      T* row_limits = tables.row_limits;
+      
+      //TODO: Even though this is only used for visualization, perhaps it should only reflect the relevant region, as determined by 'scan_height_'?
+      //TODO: Generate the whole image only on demand?
+      // The ray's y (and so the limit) is the same along a row, so the limit is computed once per row and the dense
+      // limits (only used for visualization) are filled with it. This keeps updates of the floor estimate cheap.
+      const int width = depth_msg->width;
+      for(int v=0; v< depth_msg->height; ++v)
+      {
+        cv::Point3f world_pnt = cam_model_.projectPixelTo3dRay(cv::Point2d(width - 1, v));
+        //TODO: add check for out of range number for 16U, convert to 0?
+        float z = world_pnt.z*limit_ratio(world_pnt.y)*unit_scaling; 
+        
+        T limit = z;
+        std::fill(send_data + v*width, send_data + (v+1)*width, limit);
+        row_limits[v] = limit;
+      }
+      tables.limits = (sensor_msgs::ImageConstPtr)new_msg_ptr;
+    }
+    
+    /**
+     * Returns the depth (in meters) at which the ray (x, y, 1) leaves the space between the floor and the overhead
+     * limit, using the limits and tilt in the cache.
+     * 
+     * With the camera pitched down by the tilt, the ray descends by y*cos(tilt) + sin(tilt) per unit of depth.
+     */
+    float limit_ratio(const float ray_y) const
+    {
+      float descent = (cache_.tilt == 0) ? ray_y : ray_y*std::cos(cache_.tilt) + std::sin(cache_.tilt);
+      return (descent > 0) ? cache_.floor_dist/descent : -cache_.overhead_dist/descent;
     }
     
     /**
@@ -421,13 +1192,15 @@ namespace full_depthimage_to_laserscan
     * a specific angular measurement, then the shortest range is used.
     * 
     * @param depth_msg The UInt16 or Float32 encoded depth message.
+    * @param depth_data The pixels of depth_msg.
     * @param cam_model The image_geometry camera model for this image.
     * @param scan_msg The output LaserScan.
     * @param scan_height The number of vertical pixels to feed into each angular_measurement.
     * 
     */
     template<typename T>
-    void convert_old(const sensor_msgs::ImageConstPtr& depth_msg, const image_geometry::PinholeCameraModel& cam_model, 
+    void convert_old(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* depth_data, 
+                     const image_geometry::PinholeCameraModel& cam_model, 
 		 const sensor_msgs::LaserScanPtr& scan_msg, const int& scan_height) const
     {
       // Use correct principal point from calibration
@@ -439,7 +1212,7 @@ namespace full_depthimage_to_laserscan
       float constant_x = unit_scaling / cam_model.fx();
       float constant_y = unit_scaling / cam_model.fy();
       
-      const T* depth_row = reinterpret_cast<const T*>(&depth_msg->data[0]);
+      const T* depth_row = reinterpret_cast<const T*>(depth_data);
       int row_step = depth_msg->step / sizeof(T);
 
       int offset = (int)(cam_model.cy()-scan_height/2);
@@ -454,6 +1227,7 @@ namespace full_depthimage_to_laserscan
           double r = depth; // Assign to pass through NaNs and Infs
           double th = -atan2((double)(u - center_x) * constant_x, unit_scaling); // Atan2(x, z), but depth divides out
           int index = (th - scan_msg->angle_min) / scan_msg->angle_increment;
+          index = std::min(std::max(index, 0), (int)scan_msg->ranges.size() - 1); // Rounding at the edges, as in update_mapping
           
           if (DepthTraits<T>::valid(depth)){ // Not NaN or Inf
             // Calculate in XYZ
@@ -480,10 +1254,182 @@ namespace full_depthimage_to_laserscan
       return m;
     }
     
+    template<typename T>
+    inline
+    T mymax(T a, T b) const
+    {
+      T m = std::max(a,b);
+      return m;
+    }
+    
+    /**
+     * Reduces the filtered rows to the min_support-th smallest depth of each column.
+     * 
+     * Each column keeps its min_support smallest depths in sorted order (one row of support_buffer per rank). Every new
+     * row is pushed through the ranks with a branch-free compare-exchange network; iterating over columns in the inner
+     * loop lets the compiler vectorize each compare-exchange across a full SIMD register of columns.
+     * 
+     * @param filtered The filtered depths (num_rows x ranges_size); used as scratch space.
+     * @param num_rows Number of rows in filtered.
+     * @param ranges_size Number of columns.
+     * @param big_val Value marking 'no return'.
+     * @param tolerance Depth tolerance within which the supporting pixels must lie to report the nearest one.
+     * @param cache The cache holding the support buffer.
+     * @param min_depths Output: reduced depth of each column.
+     * 
+     */
+    template<typename T>
+    void reduce_supported(T* filtered, int num_rows, int ranges_size, const T big_val, const T tolerance, 
+                          const ConversionCache& cache, T* min_depths) const
+    {
+      const int k = cache.min_support;
+      T* ranks = cache.support_buffer;
+      
+      std::fill(ranks, ranks + k*ranges_size, big_val);
+      
+      for(int v = 0; v < num_rows; ++v)
+      {
+        T* carry = filtered + v*ranges_size;
+        for(int j = 0; j < k; ++j)
+        {
+          T* rank = ranks + j*ranges_size;
+          for(int u = 0; u < ranges_size; ++u)
+          {
+            T a = rank[u];
+            T b = carry[u];
+            rank[u] = mymin(a,b);
+            carry[u] = mymax(a,b);
+          }
+        }
+      }
+      
+      const T* nearest = ranks;
+      const T* kth = ranks + (k-1)*ranges_size;
+      for(int u = 0; u < ranges_size; ++u)
+      {
+        T n = nearest[u];
+        T f = kth[u];
+        min_depths[u] = (f - n <= tolerance) ? n : f;
+      }
+    }
+    
+    /**
+     * Returns the floor limit to use: the configured floor_dist, or the estimated height minus the margin.
+     */
+    float effective_floor_dist() const;
+    
+    /**
+     * Returns the camera tilt to use: the configured one, or the estimated one.
+     */
+    float effective_tilt() const;
+    
+    /**
+     * Pixel counters of each column, filled by the kernels while collecting statistics.
+     */
+    struct ColumnCounts
+    {
+      uint16_t* valid;
+      uint16_t* accepted;
+      uint16_t* far; ///< Valid pixels rejected by the floor/overhead limit
+    };
+    
+    /**
+     * Returns the counters of the first ranges_size columns, allocated but not cleared.
+     */
+    static ColumnCounts column_counts(const int ranges_size, const ConversionCache& cache)
+    {
+      cache.column_counts.resize(3*ranges_size);
+      ColumnCounts counts;
+      counts.valid = cache.column_counts.data();
+      counts.accepted = counts.valid + ranges_size;
+      counts.far = counts.accepted + ranges_size;
+      return counts;
+    }
+    
+    /**
+     * Counts a pixel in the counters of its column.
+     * 
+     * The comparisons are the ones the filter already made, so in the vectorized loop the counts are accumulated by
+     * subtracting the same comparison masks; no extra pass over the band is needed.
+     */
+    template<typename T>
+    static void count_pixel(const T depth, const T safe_min, const bool accepted, const ColumnCounts& counts, const int u)
+    {
+      const bool valid = DepthTraits<T>::valid(depth);
+      counts.valid[u] += valid;
+      counts.accepted[u] += accepted;
+      counts.far[u] += valid && !(depth < safe_min);
+    }
+    
+    /**
+     * Returns the obstacle mask for num_rows rows of ranges_size columns of an image of type T, allocated but not
+     * cleared.
+     * 
+     * The mask is bit-packed along the columns of the band, in words as wide as a pixel: bit v%B of word
+     * (v/B)*ranges_size + u, with B the number of bits per word, holds the accepted flag of row v and column u. The
+     * bits are thus set in vectorized loops over the columns, in the lanes of the comparisons, and threads working on
+     * different columns never write the same word.
+     */
+    template<typename T>
+    static typename boost::uint_t<8*sizeof(T)>::exact* mask_groups(const int ranges_size, const int num_rows, 
+                                                                    const ConversionCache& cache)
+    {
+      typedef typename boost::uint_t<8*sizeof(T)>::exact Word;
+      const int bits = 8*sizeof(Word);
+      cache.mask_bits.resize<Word>((num_rows + bits - 1)/bits*ranges_size);
+      return cache.mask_bits;
+    }
+    
+    /**
+     * Filters the rows of the band into consecutive rows of the output buffer, counting pixels if STATS is set and
+     * recording the accepted pixels in the obstacle mask (see mask_groups) if MASK is set.
+     */
+    template<bool STATS, bool MASK, typename T>
+    void filter_band(const T* source, const int row_step, const T* safe_mins, const int num_rows, const int row_stride, 
+                     const int ranges_size, const T big_val, const T* min_depth_limits, T* min_depths, 
+                     const ColumnCounts& counts, typename boost::uint_t<8*sizeof(T)>::exact* mask) const
+    {
+      if(STATS)
+      {
+        std::fill(counts.valid, counts.valid + 3*ranges_size, 0);
+      }
+      
+      typedef typename boost::uint_t<8*sizeof(T)>::exact Word;
+      for(int v = 0, i=0; v<num_rows;v++, source += row_stride*row_step)
+      {
+        T safe_min = safe_mins[v*row_stride];
+        Word* group = NULL; // The mask is NULL unless MASK is set
+        int bit = 0;
+        Word keep = 0;
+        if(MASK)
+        {
+          group = mask + (v/(8*sizeof(Word)))*ranges_size;
+          bit = v%(8*sizeof(Word));
+          keep = bit ? ~Word(0) : 0; // The first row of a group overwrites the previous frame's bits
+        }
+        for(int u=0; u<ranges_size; ++u,++i)
+        {
+          T depth = source[u];
+          bool accepted = depth < safe_min && min_depth_limits[u] < depth;
+          min_depths[i] = accepted ? depth : big_val;
+          if(STATS)
+          {
+            count_pixel(depth, safe_min, accepted, counts, u);
+          }
+          if(MASK)
+          {
+            group[u] = (group[u] & keep) | (Word(accepted) << bit);
+          }
+        }
+      }
+    }
+    
     //We don't distinguish between infs and Nans
     template<typename T>
-    void convert_new(const sensor_msgs::ImageConstPtr& depth_msg, const image_geometry::PinholeCameraModel& cam_model, 
-                                                               const sensor_msgs::LaserScanPtr& scan_msg, const int& scan_height, const ConversionCache& cache) const
+    void convert_new(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* depth_data, 
+                     const image_geometry::PinholeCameraModel& cam_model, 
+                                                               const sensor_msgs::LaserScanPtr& scan_msg, const int& scan_height, const ConversionCache& cache, 
+                                                               const bool stats = false, const bool mask = false) const
     {
 //       // Use correct principal point from calibration
 //       float center_x = cam_model.cx();
@@ -494,7 +1440,7 @@ namespace full_depthimage_to_laserscan
 //       float constant_x = unit_scaling / cam_model.fx();
 //       float constant_y = unit_scaling / cam_model.fy();
       
-      const T* depth_row = reinterpret_cast<const T*>(depth_msg->data.data());
+      const T* depth_row = reinterpret_cast<const T*>(depth_data);
       int row_step = depth_msg->step / sizeof(T); //is this the same as image width?
       
       int offset = (int)(cam_model.cy()-scan_height/2);
@@ -503,9 +1449,7 @@ namespace full_depthimage_to_laserscan
       
       
       int ranges_size = depth_msg->width;
-      const T* limits_row = cache.row_limits;
-      const std::vector<uint16_t>& indicies = cache.indicies;
-      const std::vector<float>& range_ratios = cache.range_ratios;
+      const T* limits_row = cache.limit_tables->row_limits;
       const T* min_depth_limits = cache.min_depth_limits;
       
       limits_row += offset;
@@ -517,33 +1461,45 @@ namespace full_depthimage_to_laserscan
       T* min_depths=cache.min_depths_buffer;
       
       {
-        int num_rows = scan_height_;
+        // Only every row_stride-th row of the band is used when the quality has been reduced to meet a deadline
+        const int row_stride = row_stride_;
+        int num_rows = (scan_height_ + row_stride - 1)/row_stride;
         const T* source=depth_row;
         const T* safe_mins=limits_row; //reinterpret_cast<const T*>(cache.limits->data.data() );
         
+        const ColumnCounts counts = stats ? column_counts(ranges_size, cache) : ColumnCounts();
+        typename boost::uint_t<8*sizeof(T)>::exact* obstacle_mask = 
+          mask ? mask_groups<T>(ranges_size, num_rows, cache) : NULL;
+        if(stats && mask)
         {
-          int region_size = num_rows*ranges_size;
-          
-          //min_depths.resize(region_size, big_val);
-          for(int v = 0, i=0; v<num_rows;v++)
-          {
-            T safe_min = safe_mins[v];
-            for(int u=0; u<ranges_size; ++u,++i)
-            {
-              T depth = source[i];
-              T min_lim = min_depth_limits[u];
-              //T safe_min = safe_mins[u];
-              T filtered_depth = (depth < safe_min && min_lim < depth) ? depth : big_val;
-              min_depths[i] = filtered_depth;
-              
-              //ROS_INFO_STREAM("v=" << v << ", u=" << u << ", depth=" << depth << ", min_lim=" << min_lim << ", safe_min=" << safe_min << ", filtered_depth=" << filtered_depth);
-            }
-          }
-
+          filter_band<true, true>(source, row_step, safe_mins, num_rows, row_stride, ranges_size, big_val, 
+                                  min_depth_limits, min_depths, counts, obstacle_mask);
+        }
+        else if(stats)
+        {
+          filter_band<true, false>(source, row_step, safe_mins, num_rows, row_stride, ranges_size, big_val, 
+                                   min_depth_limits, min_depths, counts, obstacle_mask);
+        }
+        else if(mask)
+        {
+          filter_band<false, true>(source, row_step, safe_mins, num_rows, row_stride, ranges_size, big_val, 
+                                   min_depth_limits, min_depths, counts, obstacle_mask);
+        }
+        else
+        {
+          filter_band<false, false>(source, row_step, safe_mins, num_rows, row_stride, ranges_size, big_val, 
+                                    min_depth_limits, min_depths, counts, obstacle_mask);
         }
         
         source=min_depths;
         
+        if(cache.min_support > 1)
+        {
+          const T tolerance = DepthTraits<T>::fromMeters(support_tolerance_);
+          reduce_supported(min_depths, num_rows, ranges_size, big_val, tolerance, cache, min_depths);
+          num_rows = 1;
+        }
+        
         while(num_rows>1)
         {
           
@@ -580,45 +1536,882 @@ namespace full_depthimage_to_laserscan
       
       }
       
-      T max_range= DepthTraits<T>::fromMeters(scan_msg->range_max);
+      assemble_columns(min_depths, ranges_size, scan_msg, cache);
+    }
+    
+    /**
+     * Filters and reduces the columns [u_begin, u_end) of the band in a single pass.
+     * 
+     * Each filtered row is folded into the running minimum of its columns right away, so the band is read exactly
+     * once and no intermediate buffer is written. The result is identical to the halving reduction. If STATS is set,
+     * the pixels of the columns are counted as well, and if MASK is set, the accepted pixels are recorded in the mask.
+     */
+    template<bool STATS, bool MASK, typename T>
+    void reduce_fused(const T* depth_row, const int row_step, const T* limits_row, const int num_rows, 
+                      const int row_stride, const int u_begin, const int u_end, const T big_val, 
+                      const T* min_depth_limits, T* min_depths, const ColumnCounts& counts, 
+                      typename boost::uint_t<8*sizeof(T)>::exact* mask, const int mask_stride) const
+    {
+      for(int u = u_begin; u < u_end; ++u)
+      {
+        min_depths[u] = big_val;
+      }
+      if(STATS)
+      {
+        std::fill(counts.valid + u_begin, counts.valid + u_end, 0);
+        std::fill(counts.accepted + u_begin, counts.accepted + u_end, 0);
+        std::fill(counts.far + u_begin, counts.far + u_end, 0);
+      }
       
-      for(int u = 0; u < ranges_size; ++u)
+      typedef typename boost::uint_t<8*sizeof(T)>::exact Word;
+      const T* source = depth_row;
+      for(int v = 0; v < num_rows; ++v, source += row_stride*row_step)
       {
-        T depth = min_depths[u];
-        float raw_range = range_ratios[u]*depth;  //NOTE: Not sure if it matters whether this is float or T
-        
-        int index = cache.indicies[u];
-        
-        //ROS_INFO_STREAM("u=" << u << ", depth=" << depth << ", raw_range=" << raw_range << ", index=" << index);
-
-        if(raw_range < max_range)
+        T safe_min = limits_row[v*row_stride];
+        Word* group = NULL; // The mask is NULL unless MASK is set
+        int bit = 0;
+        Word keep = 0;
+        if(MASK)
         {
-          float range = DepthTraits<T>::toMeters(raw_range);
-          float& cur_ind_range = scan_msg->ranges[index];
-          
-          //ROS_INFO_STREAM("range=" << range << ", cur_ind_range=" << cur_ind_range);
-          
-          if(cur_ind_range < range)
+          group = mask + (v/(8*sizeof(Word)))*mask_stride;
+          bit = v%(8*sizeof(Word));
+          keep = bit ? ~Word(0) : 0; // The first row of a group overwrites the previous frame's bits
+        }
+        for(int u = u_begin; u < u_end; ++u)
+        {
+          T depth = source[u];
+          bool accepted = depth < safe_min && min_depth_limits[u] < depth;
+          T filtered_depth = accepted ? depth : big_val;
+          min_depths[u] = mymin(min_depths[u], filtered_depth);
+          if(STATS)
           {
+            count_pixel(depth, safe_min, accepted, counts, u);
           }
-          else
+          if(MASK)
           {
-            cur_ind_range = range;
+            group[u] = (group[u] & keep) | (Word(accepted) << bit);
           }
         }
       }
+    }
+    
+    /**
+     * Converts the depth image with the fused filter/reduction, optionally splitting the columns among threads.
+     * 
+     * @param num_threads Number of threads to use; the calling thread processes the first chunk of columns.
+     * @param stats True to fill the column counters.
+     * @param mask True to record the obstacle mask.
+     * 
+     */
+    template<typename T>
+    void convert_fused(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* depth_data, 
+                       const image_geometry::PinholeCameraModel& cam_model, 
+                       const sensor_msgs::LaserScanPtr& scan_msg, const ConversionCache& cache, const int num_threads, 
+                       const bool stats, const bool mask = false) const
+    {
+      const int row_step = depth_msg->step / sizeof(T);
+      const int offset = (int)(cam_model.cy()-scan_height_/2);
+      const T* depth_row = reinterpret_cast<const T*>(depth_data) + offset*row_step;
+      const T* limits_row = static_cast<const T*>(cache.limit_tables->row_limits) + offset;
+      const T* min_depth_limits = cache.min_depth_limits;
+      
+      const int ranges_size = depth_msg->width;
+      const int row_stride = row_stride_;
+      const int num_rows = (scan_height_ + row_stride - 1)/row_stride;
+      const T big_val = DepthTraits<T>::fromMeters(range_max_+1);
+      
+      T* min_depths = cache.min_depths_buffer;
+      const ColumnCounts counts = stats ? column_counts(ranges_size, cache) : ColumnCounts();
+      typename boost::uint_t<8*sizeof(T)>::exact* obstacle_mask = 
+        mask ? mask_groups<T>(ranges_size, num_rows, cache) : NULL;
+      
+      auto reduce = [=](const int u_begin, const int u_end) {
+        if(stats && mask)
+        {
+          reduce_fused<true, true>(depth_row, row_step, limits_row, num_rows, row_stride, u_begin, u_end, big_val, 
+                                   min_depth_limits, min_depths, counts, obstacle_mask, ranges_size);
+        }
+        else if(stats)
+        {
+          reduce_fused<true, false>(depth_row, row_step, limits_row, num_rows, row_stride, u_begin, u_end, big_val, 
+                                    min_depth_limits, min_depths, counts, obstacle_mask, ranges_size);
+        }
+        else if(mask)
+        {
+          reduce_fused<false, true>(depth_row, row_step, limits_row, num_rows, row_stride, u_begin, u_end, big_val, 
+                                    min_depth_limits, min_depths, counts, obstacle_mask, ranges_size);
+        }
+        else
+        {
+          reduce_fused<false, false>(depth_row, row_step, limits_row, num_rows, row_stride, u_begin, u_end, big_val, 
+                                     min_depth_limits, min_depths, counts, obstacle_mask, ranges_size);
+        }
+      };
       
+      run_column_chunks(ranges_size, num_threads, stats ? std::min(sizeof(T), sizeof(uint16_t)) : sizeof(T), reduce);
       
+      assemble_columns(min_depths, ranges_size, scan_msg, cache);
     }
     
-    CleanCameraModel cam_model_; ///< image_geometry helper class for managing sensor_msgs/CameraInfo messages.
-    ConversionCache cache_;
+    static const int QUANTIZED_FAR = 254; ///< Code of every depth beyond the top of the quantized range (and of NaN/inf)
+    static const int QUANTIZED_REJECTED = 255; ///< Code of filtered out pixels
+    static const int QUANTIZED_BLOCK_ROWS = 256; ///< Rows per block, so that a row within a block fits in 8 bits
     
-    float scan_time_; ///< Stores the time between scans.
+    /**
+     * Maps a depth to its 8-bit logarithmic code (see convert_quantized).
+     *
+     * The bits of a positive float grow monotonically with its value and approximate its logarithm piecewise linearly,
+     * so the code is the bit pattern of the depth relative to that of the bottom of the range, with shift bits of the
+     * mantissa dropped. Depths below the range map to 0, beyond it (and NaN/inf) to QUANTIZED_FAR.
+     */
+    template<typename T>
+    uint8_t log_code(const T depth, const int32_t base, const int shift) const
+    {
+      float value = depth;
+      int32_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      int32_t code = (mymax(bits, base) - base) >> shift; // Negative depths (sign bit set) count as below the range
+      return mymin(code, (int32_t)QUANTIZED_FAR);
+    }
+    
+    /**
+     * Filters and reduces the columns [u_begin, u_end) of the band in 8-bit codes.
+     *
+     * Like reduce_fused, but every pixel is mapped to its log_code and both the limits check and the minimum run on the
+     * codes, which packs 32 columns into an AVX2 register. Along with the smallest code, the row it was first seen in
+     * is kept; at the end of every block of QUANTIZED_BLOCK_ROWS rows, the exact depth of that pixel is read back from
+     * the image, so min_depths holds a measured depth, not a quantized one.
+     *
+     * A pixel is accepted if its code lies strictly between the codes of its limits. Since the codes are monotonic,
+     * every accepted pixel also passes the exact limits; pixels in the same code as a limit are rejected.
+     *
+     * @param row_codes Code of the floor/overhead limit of each converted row of the band.
+     * @param column_codes Code of the range_min limit of each column.
+     * @param codes Scratch: smallest code of each column within the current block.
+     * @param rows Scratch: row within the block of that code.
+     * @param best_codes Scratch: smallest code of each column so far.
+     *
+     */
+    template<typename T>
+    void reduce_quantized(const T* depth_row, const int row_step, const uint8_t* row_codes, const int num_rows,
+                          const int row_stride, const int u_begin, const int u_end, const int32_t base,
+                          const int shift, const T big_val, const uint8_t* column_codes, uint8_t* codes,
+                          uint8_t* rows, uint8_t* best_codes, T* min_depths) const
+    {
+      std::fill(best_codes + u_begin, best_codes + u_end, QUANTIZED_REJECTED);
+      std::fill(min_depths + u_begin, min_depths + u_end, big_val);
+      
+      for(int block = 0; block < num_rows; block += QUANTIZED_BLOCK_ROWS)
+      {
+        const int block_rows = std::min(num_rows - block, QUANTIZED_BLOCK_ROWS);
+        const T* block_row = depth_row + block*row_stride*row_step;
+        
+        std::fill(codes + u_begin, codes + u_end, QUANTIZED_REJECTED);
+        std::fill(rows + u_begin, rows + u_end, 0);
+        
+        const T* source = block_row;
+        for(int v = 0; v < block_rows; ++v, source += row_stride*row_step)
+        {
+          const uint8_t limit = row_codes[block + v];
+          const uint8_t row = v;
+          for(int u = u_begin; u < u_end; ++u)
+          {
+            uint8_t code = log_code(source[u], base, shift);
+            bool accepted = code < limit && column_codes[u] < code;
+            uint8_t filtered_code = accepted ? code : (uint8_t)QUANTIZED_REJECTED;
+            uint8_t nearest = codes[u];
+            bool nearer = filtered_code < nearest;
+            codes[u] = nearer ? filtered_code : nearest;
+            rows[u] = nearer ? row : rows[u];
+          }
+        }
+        
+        // Refine: only the winning pixel of each column is read again
+        for(int u = u_begin; u < u_end; ++u)
+        {
+          if(codes[u] < best_codes[u])
+          {
+            best_codes[u] = codes[u];
+            min_depths[u] = block_row[rows[u]*row_stride*row_step + u];
+          }
+        }
+      }
+    }
+    
+    /**
+     * Converts the depth image with 8-bit log-quantized depths (see set_quantize), optionally splitting the columns
+     * among threads.
+     *
+     * The codes span [bottom, top]: bottom is the smallest range_min depth limit of any column and top the depth of
+     * range_max, and the mantissa is truncated so that top still gets a code below QUANTIZED_FAR. Each code thus covers
+     * a fixed fraction of its depth (about 2% for the default 0.45-10 m), which bounds how much nearer than the reported
+     * one the true nearest pixel of a column, or the nearest pixel lost to a limit sharing its code, can be.
+     *
+     * @param num_threads Number of threads to use.
+     *
+     */
+    template<typename T>
+    void convert_quantized(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* depth_data,
+                           const image_geometry::PinholeCameraModel& cam_model,
+                           const sensor_msgs::LaserScanPtr& scan_msg, const ConversionCache& cache,
+                           const int num_threads) const
+    {
+      const int row_step = depth_msg->step / sizeof(T);
+      const int offset = (int)(cam_model.cy()-scan_height_/2);
+      const T* depth_row = reinterpret_cast<const T*>(depth_data) + offset*row_step;
+      const T* limits_row = static_cast<const T*>(cache.limit_tables->row_limits) + offset;
+      const T* min_depth_limits = cache.min_depth_limits;
+      
+      const int ranges_size = depth_msg->width;
+      const int row_stride = row_stride_;
+      const int num_rows = (scan_height_ + row_stride - 1)/row_stride;
+      const T big_val = DepthTraits<T>::fromMeters(range_max_+1);
+      
+      // The bottom is kept within 10 octaves of the top so that the codes never get coarser than with range_min 1% of range_max
+      const float top = DepthTraits<T>::fromMeters(range_max_);
+      float bottom = top;
+      for(int u = 0; u < ranges_size; ++u)
+      {
+        bottom = mymin(bottom, (float)min_depth_limits[u]);
+      }
+      bottom = mymax(bottom, top / 1024);
+      int32_t base, top_bits;
+      memcpy(&base, &bottom, sizeof(base));
+      memcpy(&top_bits, &top, sizeof(top_bits));
+      int shift = 0;
+      while(((top_bits - base) >> shift) >= QUANTIZED_FAR)
+      {
+        ++shift;
+      }
+      
+      uint8_t* codes = assume_aligned(cache.quantized_codes.data());
+      uint8_t* rows = codes + cache.quantized_stride;
+      uint8_t* best_codes = rows + cache.quantized_stride;
+      uint8_t* column_codes = best_codes + cache.quantized_stride;
+      uint8_t* row_codes = column_codes + cache.quantized_stride;
+      for(int u = 0; u < ranges_size; ++u)
+      {
+        column_codes[u] = log_code(min_depth_limits[u], base, shift);
+      }
+      for(int v = 0; v < num_rows; ++v)
+      {
+        row_codes[v] = log_code(limits_row[v*row_stride], base, shift);
+      }
+      
+      T* min_depths = cache.min_depths_buffer;
+      
+      auto reduce = [=](const int u_begin, const int u_end) {
+        reduce_quantized(depth_row, row_step, row_codes, num_rows, row_stride, u_begin, u_end, base, shift, big_val,
+                         column_codes, codes, rows, best_codes, min_depths);
+      };
+      
+      run_column_chunks(ranges_size, num_threads, sizeof(uint8_t), reduce);
+      
+      assemble_columns(min_depths, ranges_size, scan_msg, cache);
+    }
+    
+    /**
+     * Calls reduce(u_begin, u_end) on chunks of the columns, split among num_threads threads.
+     * 
+     * The chunks run on the executor if one is set, and otherwise on a pool of num_threads-1 threads that is started
+     * on first use and kept for the following frames; the calling thread processes chunks as well.
+     * 
+     * @param element_size Size of the narrowest per-column element that reduce writes (min_depths, column counters, 
+     * mask words or quantized scratch).
+     */
+    template<typename F>
+    void run_column_chunks(const int ranges_size, const int num_threads, const int element_size, const F& reduce) const
+    {
+      // Chunks are whole cache lines of the narrowest element so that threads never write to the same line
+      const int line = 64/element_size;
+      const int chunk = ((ranges_size + num_threads - 1)/num_threads + line - 1) & ~(line - 1);
+      
+      if(num_threads <= 1)
+      {
+        reduce(0, ranges_size);
+        return;
+      }
+      
+      std::vector<boost::function<void ()> > tasks;
+      for(int u_begin = 0; u_begin < ranges_size; u_begin += chunk)
+      {
+        const int u_end = std::min(u_begin + chunk, ranges_size);
+        tasks.push_back([=]() { reduce(u_begin, u_end); });
+      }
+      
+      if(executor_)
+      {
+        executor_(tasks);
+      }
+      else
+      {
+        if(!thread_pool_ || thread_pool_->num_threads() != num_threads - 1)
+        {
+          thread_pool_.reset(new WorkStealingPool(num_threads - 1));
+        }
+        thread_pool_->run_parallel(tasks);
+      }
+    }
+    
+    /**
+     * Pushes a depth through the sorted support ranks of a column, which lie stride elements apart.
+     */
+    template<typename T>
+    void push_support(T* rank, const int stride, const int k, T depth) const
+    {
+      for(int j = 0; j < k; ++j, rank += stride)
+      {
+        T a = *rank;
+        *rank = mymin(a, depth);
+        depth = mymax(a, depth);
+      }
+    }
+    
+    /**
+     * Filters and reduces the columns [u_begin, u_end) of the band of a rotated image.
+     * 
+     * With 90 or 270 degrees the view's rows are adjacent in memory, so every column of the band is a contiguous run
+     * of an image row and is reduced on its own along that run. With 180 degrees the rows of the band are image rows
+     * read backwards and are reduced row by row like in reduce_fused. Columns are reduced to the min_support-th
+     * smallest depth like in reduce_supported, keeping their ranks in the support buffer. If STATS is set, the pixels
+     * are counted as well.
+     * 
+     * @param band The view of the first row of the band.
+     * @param tolerance Depth tolerance within which the supporting pixels must lie to report the nearest one.
+     * 
+     */
+    template<bool STATS, typename T>
+    void reduce_rotated(const RotatedView<T>& band, const T* limits_row, const int num_rows, const int row_stride, 
+                        const int u_begin, const int u_end, const T big_val, const T tolerance, 
+                        const T* min_depth_limits, const ConversionCache& cache, T* min_depths, 
+                        const ColumnCounts& counts) const
+    {
+      const int ranges_size = band.width;
+      const int k = cache.min_support;
+      T* ranks = cache.support_buffer;
+      
+      for(int j = 0; j < k; ++j)
+      {
+        std::fill(ranks + j*ranges_size + u_begin, ranks + j*ranges_size + u_end, big_val);
+      }
+      if(STATS)
+      {
+        std::fill(counts.valid + u_begin, counts.valid + u_end, 0);
+        std::fill(counts.accepted + u_begin, counts.accepted + u_end, 0);
+        std::fill(counts.far + u_begin, counts.far + u_end, 0);
+      }
+      
+      const int pixel_step = row_stride*band.row_step;
+      
+      if(band.row_step == 1 || band.row_step == -1)
+      {
+        for(int u = u_begin; u < u_end; ++u)
+        {
+          const T* source = &band(u, 0);
+          const T min_depth_limit = min_depth_limits[u];
+          
+          if(k == 1)
+          {
+            T nearest = big_val;
+            for(int v = 0; v < num_rows; ++v)
+            {
+              T depth = source[v*pixel_step];
+              T safe_min = limits_row[v*row_stride];
+              bool accepted = depth < safe_min && min_depth_limit < depth;
+              nearest = mymin(nearest, accepted ? depth : big_val);
+              if(STATS)
+              {
+                count_pixel(depth, safe_min, accepted, counts, u);
+              }
+            }
+            ranks[u] = nearest;
+          }
+          else
+          {
+            for(int v = 0; v < num_rows; ++v)
+            {
+              T depth = source[v*pixel_step];
+              T safe_min = limits_row[v*row_stride];
+              bool accepted = depth < safe_min && min_depth_limit < depth;
+              push_support(ranks + u, ranges_size, k, accepted ? depth : big_val);
+              if(STATS)
+              {
+                count_pixel(depth, safe_min, accepted, counts, u);
+              }
+            }
+          }
+        }
+      }
+      else
+      {
+        // 180 degrees: the columns of the view run backwards through an image row (col_step == -1)
+        for(int v = 0; v < num_rows; ++v)
+        {
+          const T* source = &band(0, v*row_stride);
+          T safe_min = limits_row[v*row_stride];
+          for(int u = u_begin; u < u_end; ++u)
+          {
+            T depth = source[-u];
+            bool accepted = depth < safe_min && min_depth_limits[u] < depth;
+            T filtered_depth = accepted ? depth : big_val;
+            if(k == 1)
+            {
+              ranks[u] = mymin(ranks[u], filtered_depth);
+            }
+            else
+            {
+              push_support(ranks + u, ranges_size, k, filtered_depth);
+            }
+            if(STATS)
+            {
+              count_pixel(depth, safe_min, accepted, counts, u);
+            }
+          }
+        }
+      }
+      
+      const T* kth = ranks + (k-1)*ranges_size;
+      for(int u = u_begin; u < u_end; ++u)
+      {
+        T n = ranks[u];
+        T f = kth[u];
+        min_depths[u] = (f - n <= tolerance) ? n : f;
+      }
+    }
+    
+    /**
+     * Converts a rotated depth image (see set_rotation), optionally splitting the columns among threads.
+     * 
+     * The cache holds the tables of the virtual upright camera, whose model is cam_model_.
+     * 
+     * @param num_threads Number of threads to use.
+     * @param stats True to fill the column counters.
+     * 
+     */
+    template<typename T>
+    void convert_rotated(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* depth_data, 
+                         const sensor_msgs::LaserScanPtr& scan_msg, 
+                         const ConversionCache& cache, const int num_threads, const bool stats) const
+    {
+      const int offset = (int)(cam_model_.cy()-scan_height_/2);
+      RotatedView<T> band = rotated_view<T>(*depth_msg, depth_data, rotation_);
+      band.origin = &band(0, offset);
+      
+      const T* limits_row = static_cast<const T*>(cache.limit_tables->row_limits) + offset;
+      const T* min_depth_limits = cache.min_depth_limits;
+      
+      const int ranges_size = band.width;
+      const int row_stride = row_stride_;
+      const int num_rows = (scan_height_ + row_stride - 1)/row_stride;
+      const T big_val = DepthTraits<T>::fromMeters(range_max_+1);
+      const T tolerance = DepthTraits<T>::fromMeters(support_tolerance_);
+      
+      T* min_depths = cache.min_depths_buffer;
+      const ColumnCounts counts = stats ? column_counts(ranges_size, cache) : ColumnCounts();
+      
+      auto reduce = [=, &cache](const int u_begin, const int u_end) {
+        if(stats)
+        {
+          reduce_rotated<true>(band, limits_row, num_rows, row_stride, u_begin, u_end, big_val, tolerance, 
+                               min_depth_limits, cache, min_depths, counts);
+        }
+        else
+        {
+          reduce_rotated<false>(band, limits_row, num_rows, row_stride, u_begin, u_end, big_val, tolerance, 
+                                min_depth_limits, cache, min_depths, counts);
+        }
+      };
+      
+      run_column_chunks(ranges_size, num_threads, stats ? std::min(sizeof(T), sizeof(uint16_t)) : sizeof(T), reduce);
+      
+      assemble_columns(min_depths, ranges_size, scan_msg, cache);
+    }
+    
+    /**
+     * Runs the conversion of one frame with the given kernel (see Kernel).
+     * 
+     * The pixels are read from depth_data, which is either depth_msg's data or external memory (see convert_buffer).
+     */
+    template<typename T>
+    void convert_kernel(const int kernel, const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* depth_data, 
+                        const sensor_msgs::LaserScanPtr& scan_msg)
+    {
+      PERF_STAGE(profiler_, STAGE_CONVERT);
+      
+      const bool fusable = cache_.min_support == 1;
+      const bool quantized = cache_.quantize && fusable && kernel != KERNEL_REFERENCE && boost::is_same<T, float>::value;
+      const bool stats = collect_stats_ && (rotation_ != 0 || (kernel != KERNEL_REFERENCE && !cache_.undistort && 
+                         !(cache_.incremental && fusable) && !quantized));
+      const bool mask = collect_mask_ && rotation_ == 0 && kernel != KERNEL_REFERENCE && !cache_.undistort && 
+                        !(cache_.incremental && fusable) && !quantized;
+      
+      if(rotation_ != 0)
+      {
+        convert_rotated<T>(depth_msg, depth_data, scan_msg, cache_, (kernel == KERNEL_THREADED) ? num_threads_ : 1, stats);
+      }
+      else if(cache_.undistort)
+      {
+        convert_raw<T>(depth_msg, depth_data, scan_msg, cache_);
+        check_safety_ranges<T>(*scan_msg, cache_);
+      }
+      else if(cache_.incremental && fusable)
+      {
+        convert_incremental<T>(depth_msg, depth_data, cam_model_, scan_msg, cache_);
+      }
+      else if(quantized)
+      {
+        convert_quantized<T>(depth_msg, depth_data, cam_model_, scan_msg, cache_, 
+                             (kernel == KERNEL_THREADED) ? num_threads_ : 1);
+      }
+      else if(kernel == KERNEL_REFERENCE)
+      {
+        // The reference kernel only replaces ranges, so it needs the 'no return' value up front
+        scan_msg->ranges.assign(depth_msg->width, std::numeric_limits<float>::quiet_NaN());
+        convert_old<T>(depth_msg, depth_data, cam_model_, scan_msg, scan_height_);
+        check_safety_ranges<T>(*scan_msg, cache_);
+      }
+      else if(kernel == KERNEL_FUSED && fusable)
+      {
+        convert_fused<T>(depth_msg, depth_data, cam_model_, scan_msg, cache_, 1, stats, mask);
+      }
+      else if(kernel == KERNEL_THREADED && fusable)
+      {
+        convert_fused<T>(depth_msg, depth_data, cam_model_, scan_msg, cache_, num_threads_, stats, mask);
+      }
+      else
+      {
+        convert_new<T>(depth_msg, depth_data, cam_model_, scan_msg, scan_height_, cache_, stats, mask);
+      }
+      
+      mask_valid_ = mask;
+      if(mask)
+      {
+        mask_header_ = depth_msg->header;
+        mask_width_ = depth_msg->width;
+        mask_height_ = depth_msg->height;
+        mask_offset_ = (int)(cam_model_.cy()-scan_height_/2);
+        mask_row_stride_ = row_stride_;
+        mask_num_rows_ = (scan_height_ + row_stride_ - 1)/row_stride_;
+        mask_word_bits_ = 8*sizeof(T);
+      }
+      
+      stats_valid_ = stats;
+      if(stats)
+      {
+        summarize_stats(cache_.geometry->indicies.size(), (scan_height_ + row_stride_ - 1)/row_stride_, *scan_msg);
+      }
+    }
+    
+    /**
+     * Sums the column counters of the last conversion into stats_ and counts the beams without a return or backed
+     * by a single pixel.
+     */
+    void summarize_stats(const int ranges_size, const int num_rows, const sensor_msgs::LaserScan& scan_msg);
+    
+    /**
+     * Records the time a candidate kernel took in KERNEL_AUTO mode and settles on the fastest once all are timed.
+     */
+    void record_autotune(const int kernel, const double time);
+    
+    /**
+     * Discards the autotuning results, e.g. because the input changed.
+     */
+    void reset_autotune();
+    
+    /**
+     * Converts the reduced depth of each column to a range and builds the output ranges from them.
+     * 
+     * @param min_depths The reduced depth of each column.
+     * @param ranges_size Number of columns.
+     * @param scan_msg The output LaserScan.
+     * @param cache The cache holding the range ratios and beam tables.
+     * 
+     */
+    template<typename T>
+    void assemble_columns(const T* min_depths, const int ranges_size, const sensor_msgs::LaserScanPtr& scan_msg, 
+                          const ConversionCache& cache) const
+    {
+      PERF_STAGE(profiler_, STAGE_ASSEMBLE);
+      
+      check_safety(min_depths, ranges_size, cache);
+      remember_minima(min_depths, cache);
+      
+      const float* range_ratios = assume_aligned(cache.geometry->range_ratios.data());
+      
+      T max_range= DepthTraits<T>::fromMeters(scan_msg->range_max);
+      
+      const float no_return = std::numeric_limits<float>::infinity();
+      float* column_ranges = assume_aligned(cache.column_ranges.data());
+      
+      for(int u = 0; u < ranges_size; ++u)
+      {
+        T depth = min_depths[u];
+        float raw_range = range_ratios[u]*depth;  //NOTE: Not sure if it matters whether this is float or T
+        
+        column_ranges[u] = (raw_range < max_range) ? DepthTraits<T>::toMeters(raw_range) : no_return;
+      }
+      
+      assemble_beams(cache, scan_msg->ranges, ranges_size);
+    }
+    
+    /**
+     * Converts the depth image incrementally, reprocessing only the column strips that changed.
+     * 
+     * The band is split into strips of INCREMENTAL_STRIP_WIDTH columns. For each strip, every
+     * INCREMENTAL_SAMPLE_INTERVAL-th row of the filtered depths of the current frame is compared with the frame the
+     * strip was last computed from; only if any of them differs by more than the tolerance are the strip's filtered
+     * depths and column minima recomputed. The sampled rows shift by one every frame, so every row is compared within
+     * INCREMENTAL_SAMPLE_INTERVAL frames, while an unchanged strip costs only a fraction of a full pass. Comparing the
+     * filtered depths (rather than the raw ones) means that invalid pixels and changes outside of the floor/overhead
+     * limits never cause a recompute. Every incremental_refresh frames all strips are recomputed.
+     * 
+     * @param depth_msg The UInt16 or Float32 encoded depth message.
+     * @param depth_data The pixels of depth_msg.
+     * @param cam_model The image_geometry camera model for this image.
+     * @param scan_msg The output LaserScan.
+     * @param cache The cache holding the per-strip state of the previous frames.
+     * 
+     */
+    template<typename T>
+    void convert_incremental(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* depth_data, 
+                             const image_geometry::PinholeCameraModel& cam_model, 
+                             const sensor_msgs::LaserScanPtr& scan_msg, const ConversionCache& cache) const
+    {
+      const int ranges_size = depth_msg->width;
+      const int row_step = depth_msg->step / sizeof(T);
+      const int row_stride = row_stride_;
+      const int num_rows = (scan_height_ + row_stride - 1)/row_stride;
+      
+      const int offset = (int)(cam_model.cy()-scan_height_/2);
+      const T* depth_row = reinterpret_cast<const T*>(depth_data) + offset*row_step;
+      const T* limits_row = static_cast<const T*>(cache.limit_tables->row_limits) + offset;
+      const T* min_depth_limits = cache.min_depth_limits;
+      
+      const T big_val = DepthTraits<T>::fromMeters(range_max_+1);
+      const T tolerance = DepthTraits<T>::fromMeters(incremental_tolerance_);
+      
+      T* previous = cache.incremental_depths;
+      T* minima = cache.incremental_minima;
+      
+      bool refresh = !cache.incremental_valid || cache.incremental_row_stride != row_stride || 
+        cache.incremental_frames >= incremental_refresh_;
+      
+      const int first_sample = (cache.incremental_frames % INCREMENTAL_SAMPLE_INTERVAL) % num_rows;
+      
+      for(int start = 0; start < ranges_size; start += INCREMENTAL_STRIP_WIDTH)
+      {
+        const int end = std::min(start + INCREMENTAL_STRIP_WIDTH, ranges_size);
+        
+        bool changed = refresh;
+        for(int v = first_sample; v < num_rows && !changed; v += INCREMENTAL_SAMPLE_INTERVAL)
+        {
+          const T* source = depth_row + v*row_stride*row_step;
+          const T* prev = previous + v*ranges_size;
+          const T safe_min = limits_row[v*row_stride];
+          
+          int differences = 0;
+          for(int u = start; u < end; ++u)
+          {
+            T depth = source[u];
+            T filtered_depth = (depth < safe_min && min_depth_limits[u] < depth) ? depth : big_val;
+            T difference = mymax(filtered_depth, prev[u]) - mymin(filtered_depth, prev[u]);
+            differences += (difference > tolerance);
+          }
+          changed = differences > 0;
+        }
+        
+        if(!changed)
+        {
+          continue;
+        }
+        
+        std::fill(minima + start, minima + end, big_val);
+        for(int v = 0; v < num_rows; ++v)
+        {
+          const T* source = depth_row + v*row_stride*row_step;
+          T* prev = previous + v*ranges_size;
+          const T safe_min = limits_row[v*row_stride];
+          
+          for(int u = start; u < end; ++u)
+          {
+            T depth = source[u];
+            T filtered_depth = (depth < safe_min && min_depth_limits[u] < depth) ? depth : big_val;
+            prev[u] = filtered_depth;
+            minima[u] = mymin(minima[u], filtered_depth);
+          }
+        }
+      }
+      
+      cache.incremental_valid = true;
+      cache.incremental_row_stride = row_stride;
+      cache.incremental_frames = refresh ? 1 : cache.incremental_frames + 1;
+      
+      assemble_columns(static_cast<const T*>(minima), ranges_size, scan_msg, cache);
+    }
+    
+    /**
+     * Converts a raw (distorted) depth image using the per-pixel undistortion tables.
+     * 
+     * Distortion bends image rows and columns, so pixels of the same column no longer share a beam. Each pixel of the
+     * band is therefore filtered with its own limits and min-reduced directly into the beam it maps to.
+     * 
+     * @param depth_msg The UInt16 or Float32 encoded raw depth message.
+     * @param depth_data The pixels of depth_msg.
+     * @param scan_msg The output LaserScan.
+     * @param cache The cache holding the undistortion tables.
+     * 
+     */
+    template<typename T>
+    void convert_raw(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* depth_data, 
+                     const sensor_msgs::LaserScanPtr& scan_msg, 
+                     const ConversionCache& cache) const
+    {
+      const int width = depth_msg->width;
+      const int row_step = depth_msg->step / sizeof(T);
+      const T* depth_row = reinterpret_cast<const T*>(depth_data) + cache.raw_offset*row_step;
+      
+      const int32_t* beams = assume_aligned(cache.raw_beams.data());
+      const float* ratios = assume_aligned(cache.raw_ratios.data());
+      const T* max_depths = cache.raw_max_depths;
+      const T* min_depths = cache.raw_min_depths;
+      
+      const T max_range = DepthTraits<T>::fromMeters(scan_msg->range_max);
+      const float no_return = std::numeric_limits<float>::infinity();
+      const float nan = std::numeric_limits<float>::quiet_NaN();
+      
+      const int num_beams = width;
+      scan_msg->ranges.assign(num_beams, no_return);
+      float* ranges = scan_msg->ranges.data();
+      
+      const int row_stride = row_stride_;
+      for(int v = 0; v < scan_height_; v += row_stride, depth_row += row_stride*row_step)
+      {
+        for(int u = 0, i = v*width; u < width; ++u, ++i)
+        {
+          T depth = depth_row[u];
+          float raw_range = ratios[i]*depth;
+          bool valid = depth < max_depths[i] && min_depths[i] < depth && raw_range < max_range;
+          float range = valid ? DepthTraits<T>::toMeters(raw_range) : no_return;
+          
+          float& beam_range = ranges[beams[i]];
+          beam_range = mymin(beam_range, range);
+        }
+      }
+      
+      for(int i = 0; i < num_beams; ++i)
+      {
+        float range = ranges[i];
+        ranges[i] = (range < no_return) ? range : nan;
+      }
+    }
+    
+    /**
+     * Keeps a pointer to the column minima of the last conversion for compact_ranges (uint16 images only).
+     */
+    static void remember_minima(const uint16_t* min_depths, const ConversionCache& cache)
+    {
+      cache.last_minima = min_depths;
+    }
+    
+    static void remember_minima(const float* min_depths, const ConversionCache& cache)
+    {
+      cache.last_minima = NULL;
+    }
+    
+    /**
+     * Builds the output ranges from the per-column ranges with a gather.
+     * 
+     * Every beam takes the minimum over its precomputed source columns (see beam_columns), so no branches are needed.
+     * The first gather allocates the ranges with assign, so they are never zero-filled before being written. Beams
+     * without a return, including those that no column maps to (holes in the non-uniform atan mapping), are set to NaN
+     * explicitly.
+     * 
+     * @param cache The cache holding the beam tables and the ranges of each column.
+     * @param ranges_vector The output ranges; resized to num_beams.
+     * @param num_beams Number of output ranges.
+     * 
+     */
+    void assemble_beams(const ConversionCache& cache, std::vector<float>& ranges_vector, const int num_beams) const
+    {
+      const float no_return = std::numeric_limits<float>::infinity();
+      const float nan = std::numeric_limits<float>::quiet_NaN();
+      const float* column_ranges = assume_aligned(cache.column_ranges.data());
+      const int32_t* columns = assume_aligned(cache.geometry->beam_columns.data());
+      
+      ranges_vector.assign(boost::make_permutation_iterator(column_ranges, columns), 
+                           boost::make_permutation_iterator(column_ranges, columns + num_beams));
+      float* ranges = ranges_vector.data();
+      
+      for(int j = 1; j < cache.geometry->beam_taps; ++j)
+      {
+        const int32_t* tap = columns + j*num_beams;
+        for(int i = 0; i < num_beams; ++i)
+        {
+          ranges[i] = mymin(ranges[i], column_ranges[tap[i]]);
+        }
+      }
+      
+      for(int i = 0; i < num_beams; ++i)
+      {
+        float range = ranges[i];
+        ranges[i] = (range < no_return) ? range : nan;
+      }
+    }
+    
+    CleanCameraModel cam_model_; ///< image_geometry helper class for managing sensor_msgs/CameraInfo messages.
+    ConversionCache cache_;
+    
+    float scan_time_; ///< Stores the time between scans.
     float range_min_; ///< Stores the current minimum range to use.
     float range_max_; ///< Stores the current maximum range to use.
     int scan_height_; ///< Number of pixel rows to use when producing a laserscan from an area.
     float floor_dist_, overhead_dist_;
+    float tilt_; ///< Configured downward tilt of the camera (in radians).
+    bool floor_estimation_; ///< True if the floor plane is estimated online.
+    float floor_margin_; ///< Height of the floor limit above the estimated floor (in meters).
+    FloorEstimator floor_estimator_; ///< Background estimator of the floor plane.
+    bool floor_estimate_valid_; ///< True if floor_estimate_ holds an estimate.
+    FloorEstimator::Plane floor_estimate_; ///< Latest estimate of the floor plane.
+    int min_support_; ///< Number of pixels that must support a reported range.
+    float support_tolerance_; ///< Depth tolerance (in meters) for supporting pixels.
+    std::vector<Polygon> safety_zones_; ///< Protective zones for the safety stop, in order of priority.
+    int safety_min_columns_; ///< Number of columns inside a zone that confirm a violation.
+    bool safety_zones_changed_; ///< True if the safety tables must be rebuilt.
+    boost::function<void (int)> safety_cb_; ///< Receives the index of the violated zone (or -1) for every frame.
+    bool incremental_; ///< True if only changed column strips are reprocessed.
+    float incremental_tolerance_; ///< Depth change (in meters) below which a pixel is considered unchanged.
+    int incremental_refresh_; ///< Number of frames between full refreshes of the incremental conversion.
+    bool quantize_; ///< True if the band is reduced in 8-bit log-quantized depths.
+    int row_stride_; ///< Distance between consecutive converted rows of the band.
+    bool undistort_; ///< True if the input image is raw and is undistorted during the conversion.
+    int rotation_; ///< Clockwise rotation (in degrees) that turns the image upright.
+    sensor_msgs::CameraInfoConstPtr rotated_source_; ///< CameraInfo that rotated_info_ was derived from.
+    int rotated_source_rotation_; ///< Rotation that rotated_info_ was derived with.
+    sensor_msgs::CameraInfoConstPtr rotated_info_; ///< Calibration of the virtual upright camera.
+    sensor_msgs::CameraInfoConstPtr cloud_info_; ///< Intrinsics estimated from point clouds without a CameraInfo.
+    float grid_resolution_; ///< Cell size of the local occupancy grid.
+    int grid_size_; ///< Number of cells along each edge of the local occupancy grid (0 = disabled).
+    int num_threads_; ///< Number of threads used by KERNEL_THREADED.
+    mutable boost::shared_ptr<WorkStealingPool> thread_pool_; ///< Threads of KERNEL_THREADED without an executor
+    ParallelExecutor executor_; ///< External thread pool for KERNEL_THREADED, if set.
+    int tuned_kernel_; ///< Kernel chosen by autotuning, KERNEL_AUTO while still tuning.
+    int autotune_frame_; ///< Number of frames timed so far.
+    bool collect_stats_; ///< True if the kernels count pixels and beams for ConversionStats.
+    bool stats_valid_; ///< True if stats_ holds the counters of the last conversion.
+    ConversionStats stats_; ///< Counters of the last conversion.
+    std::vector<uint32_t> beam_pixels_; ///< Accepted pixels of each beam, scratch space for summarize_stats.
+    bool collect_mask_; ///< True if the kernels record the obstacle mask.
+    bool mask_valid_; ///< True if cache_.mask_bits holds the obstacle mask of the last conversion.
+    std_msgs::Header mask_header_; ///< Header of the depth image the mask was recorded from.
+    uint32_t mask_width_, mask_height_; ///< Size of the depth image the mask was recorded from.
+    int mask_offset_; ///< First image row of the band.
+    int mask_row_stride_; ///< Row stride the mask was recorded with.
+    int mask_num_rows_; ///< Number of rows in the mask.
+    int mask_word_bits_; ///< Bits per word of the mask (see mask_groups).
+#ifdef FULL_DEPTHIMAGE_TO_LASERSCAN_PERF_COUNTERS
+    mutable PerfProfiler profiler_; ///< Hardware performance counters of the conversion stages.
+#endif
+    std::vector<double> autotune_times_; ///< Best time of each candidate kernel so far.
     std::string output_frame_id_; ///< Output frame_id for each laserscan.  This is likely NOT the camera's frame_id.
   };
   
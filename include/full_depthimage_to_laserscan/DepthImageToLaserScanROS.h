@@ -38,11 +38,28 @@
 #include <image_transport/image_transport.h>
 #include <sensor_msgs/Image.h>
 #include <sensor_msgs/LaserScan.h>
+#include <stereo_msgs/DisparityImage.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <message_filters/subscriber.h>
+#include <message_filters/time_synchronizer.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <std_msgs/UInt8.h>
+#include <std_msgs/Int8.h>
+#include <std_msgs/Bool.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <boost/thread/mutex.hpp>
+#include <atomic>
 #include <dynamic_reconfigure/server.h>
 #include <full_depthimage_to_laserscan/DepthConfig.h>
+#include <full_depthimage_to_laserscan/GetScan.h>
 
 #include <full_depthimage_to_laserscan/DepthImageToLaserScan.h>
+#include <full_depthimage_to_laserscan/QualityScheduler.h>
+#include <full_depthimage_to_laserscan/ScanDiagnostics.h>
+#include <full_depthimage_to_laserscan/WorkStealingPool.h>
+#include <full_depthimage_to_laserscan/compact_scan.h>
+#include <full_depthimage_to_laserscan/scan_shm.h>
+#include <full_depthimage_to_laserscan/pooled_image.h>
 
 
 namespace full_depthimage_to_laserscan
@@ -50,7 +67,15 @@ namespace full_depthimage_to_laserscan
   class DepthImageToLaserScanROS
   {
   public:
-    DepthImageToLaserScanROS(ros::NodeHandle& n, ros::NodeHandle& pnh);
+    /**
+     * @param n Nodehandle for the input and output topics.
+     * @param pnh Private nodehandle for the parameters.
+     * @param pool Shared thread pool to run the conversions on (see DepthImageToLaserScanMultiNodelet); if empty,
+     *             conversions run in the subscriber callbacks.
+     * 
+     */
+    DepthImageToLaserScanROS(ros::NodeHandle& n, ros::NodeHandle& pnh, 
+                             const boost::shared_ptr<WorkStealingPool>& pool = boost::shared_ptr<WorkStealingPool>());
     
     ~DepthImageToLaserScanROS();
 
@@ -66,6 +91,76 @@ namespace full_depthimage_to_laserscan
      */
     void depthCb(const sensor_msgs::ImageConstPtr& depth_msg,
 		  const sensor_msgs::CameraInfoConstPtr& info_msg);
+    
+    /**
+     * Callback for synchronized depth image and camera info, used instead of depthCb for raw images if pooled_images
+     * is set.
+     * 
+     * @param depth_msg Depth image deserialized into a pooled buffer.
+     * @param info_msg CameraInfo of the depth image.
+     * 
+     */
+    void pooledDepthCb(const PooledImageConstPtr& depth_msg, const sensor_msgs::CameraInfoConstPtr& info_msg);
+    
+    /**
+     * Callback for synchronized disparity image and camera info, used instead of depthCb if use_disparity is set.
+     * 
+     * @param disparity_msg DisparityImage from a stereo pipeline.
+     * @param info_msg CameraInfo of the camera the disparity image is registered to.
+     * 
+     */
+    void disparityCb(const stereo_msgs::DisparityImageConstPtr& disparity_msg,
+                     const sensor_msgs::CameraInfoConstPtr& info_msg);
+    
+    /**
+     * Callback for organized point clouds, used instead of depthCb if use_cloud is set.
+     * 
+     * The cloud is converted with the latest CameraInfo received by cloudInfoCb, or with estimated intrinsics if none
+     * has been received.
+     * 
+     * @param cloud_msg Organized PointCloud2 in the optical frame of the camera.
+     * 
+     */
+    void cloudCb(const sensor_msgs::PointCloud2ConstPtr& cloud_msg);
+    
+    /**
+     * Keeps the CameraInfo of the camera the clouds come from; clouds and CameraInfo are not synchronized.
+     */
+    void cloudInfoCb(const sensor_msgs::CameraInfoConstPtr& info_msg);
+    
+    typedef boost::function<sensor_msgs::LaserScanPtr (sensor_msgs::ImageConstPtr&)> ConvertFunction;
+    
+    /**
+     * Converts one frame and publishes the scan and all derived outputs.
+     * 
+     * @param convert Runs the conversion of the frame; may set the mask image.
+     * @param stamp Time stamp of the frame.
+     * @param allow_skip False to ignore frame skipping by the quality scheduler.
+     * @return The scan, or NULL if the frame was skipped or couldn't be converted.
+     * 
+     */
+    sensor_msgs::LaserScanPtr processFrame(const ConvertFunction& convert, const ros::Time& stamp, 
+                                           const bool allow_skip = true);
+    
+    /**
+     * Pull mode: converts the latest retained frame, unless its scan is already cached.
+     * 
+     * The scan is published like in push mode.
+     * 
+     * @return The scan of the latest frame, or NULL if no frame has been converted yet.
+     * 
+     */
+    sensor_msgs::LaserScanConstPtr pullScan();
+    
+    /**
+     * Service callback for get_scan.
+     */
+    bool getScanCb(full_depthimage_to_laserscan::GetScan::Request& req, full_depthimage_to_laserscan::GetScan::Response& res);
+    
+    /**
+     * Timer callback converting and publishing at pull_rate in pull mode, if anything subscribes.
+     */
+    void pullTimerCb(const ros::TimerEvent& event);
 
     /**
      * Callback that is called when there is a new subscriber.
@@ -83,6 +178,46 @@ namespace full_depthimage_to_laserscan
      */
     void disconnectCb(const ros::SingleSubscriberPublisher& pub);
     
+    /**
+     * Subscribes to the input if anything needs it (always in pull mode). Requires connect_mutex_.
+     */
+    void subscribe();
+    
+    /**
+     * Returns true if any of the outputs that require the depth image has a subscriber.
+     */
+    bool hasSubscribers() const;
+    
+    /**
+     * Reads the protective zones for the safety stop from the 'safety_zones' parameter.
+     * 
+     * The parameter is a list of polygons, each a list of [x, y] points in the output frame.
+     * 
+     */
+    void loadSafetyZones();
+    
+    /**
+     * Callback for the safety check of DepthImageToLaserScan.
+     * 
+     * Publishes the safety state immediately, or keeps it until the scan has been published if safety_before_scan is false.
+     * 
+     * @param zone Index of the violated zone, or -1 if no zone is violated.
+     * 
+     */
+    void safetyCb(int zone);
+    
+    /**
+     * Reports the kernel in use (e.g. the result of autotuning) in the selected_kernel parameter when it changes.
+     */
+    void reportKernel();
+    
+    /**
+     * Publishes the safety state on safety_stop and safety_zone.
+     */
+    void publishSafety(int zone);
+    
+    void writeShm(const sensor_msgs::LaserScan& scan_msg);
+    
     /**
      * Dynamic reconfigure callback.
      * 
@@ -94,17 +229,73 @@ namespace full_depthimage_to_laserscan
      */
     void reconfigureCb(full_depthimage_to_laserscan::DepthConfig& config, uint32_t level);
     
+    ros::NodeHandle nh_; ///< Nodehandle used for the disparity subscriptions.
     ros::NodeHandle pnh_; ///< Private nodehandle used to generate the transport hints in the connectCb.
     image_transport::ImageTransport it_; ///< Subscribes to synchronized Image CameraInfo pairs.
     image_transport::CameraSubscriber sub_; ///< Subscriber for image_transport
+    
+    typedef message_filters::TimeSynchronizer<PooledImage, sensor_msgs::CameraInfo> PooledSync;
+    bool pooled_images_; ///< Deserialize raw depth images into pooled buffers instead of subscribing with image_transport
+    bool pooled_subscribed_; ///< True while the pooled image subscribers are connected
+    message_filters::Subscriber<PooledImage> pooled_sub_;
+    message_filters::Subscriber<sensor_msgs::CameraInfo> pooled_info_sub_;
+    boost::shared_ptr<PooledSync> pooled_sync_;
+    
+    typedef message_filters::TimeSynchronizer<stereo_msgs::DisparityImage, sensor_msgs::CameraInfo> DisparitySync;
+    bool use_disparity_; ///< Subscribe to a disparity image instead of a depth image
+    bool disparity_subscribed_; ///< True while the disparity subscribers are connected
+    message_filters::Subscriber<stereo_msgs::DisparityImage> disparity_sub_;
+    message_filters::Subscriber<sensor_msgs::CameraInfo> disparity_info_sub_;
+    boost::shared_ptr<DisparitySync> disparity_sync_;
+    
+    bool use_cloud_; ///< Subscribe to an organized point cloud instead of a depth image
+    ros::Subscriber cloud_sub_;
+    ros::Subscriber cloud_info_sub_;
+    sensor_msgs::CameraInfoConstPtr cloud_info_; ///< Latest CameraInfo of the cloud's camera, if any (protected by frame_mutex_)
+    
+    boost::shared_ptr<WorkStealingPool> pool_; ///< Shared thread pool running the conversions, if any
+    int pool_stream_; ///< Id of this converter's stream in pool_
+    
+    bool pull_mode_; ///< Only retain frames and convert them on request
+    boost::mutex frame_mutex_; ///< Protects the latest_* frames
+    sensor_msgs::ImageConstPtr latest_depth_; ///< Latest depth image (pull mode)
+    PooledImageConstPtr latest_pooled_; ///< Latest depth image in a pooled buffer (pull mode)
+    stereo_msgs::DisparityImageConstPtr latest_disparity_; ///< Latest disparity image (pull mode)
+    sensor_msgs::PointCloud2ConstPtr latest_cloud_; ///< Latest point cloud (pull mode)
+    sensor_msgs::CameraInfoConstPtr latest_info_; ///< CameraInfo of the latest frame (pull mode)
+    boost::mutex pull_mutex_; ///< Serializes pulled conversions
+    boost::shared_ptr<const void> pulled_frame_; ///< Frame the cached scan was converted from
+    unsigned int pulled_generation_; ///< config_generation_ the cached scan was converted with
+    std::atomic<unsigned int> config_generation_; ///< Bumped by reconfigureCb, which must not take pull_mutex_
+    sensor_msgs::LaserScanConstPtr pulled_scan_; ///< Cached scan of pulled_frame_
+    ros::ServiceServer scan_srv_; ///< get_scan service
+    ros::Timer pull_timer_; ///< Rate-limited conversions in pull mode
     image_transport::Publisher im_pub_;
+    image_transport::Publisher obstacle_mask_pub_; ///< Publisher for the pixels accepted as obstacles; only recorded while subscribed
     ros::Publisher pub_; ///< Publisher for output LaserScan messages
+    ros::Publisher grid_pub_; ///< Publisher for the local occupancy grid rasterized from the LaserScan
+    ros::Publisher compact_pub_; ///< Publisher for the millimetre-quantized, optionally delta-encoded scan
+    CompactScanEncoder compact_encoder_; ///< Encoder state of the compact_scan stream
+    std::string shm_name_; ///< Shared-memory object receiving every scan, empty if disabled
+    int shm_slots_; ///< Number of slots in the shared-memory ring
+    ScanShmWriter shm_writer_; ///< Writer of the shared-memory ring, opened with the first scan
+    ros::Publisher safety_stop_pub_; ///< Publisher for the safety stop flag
+    ros::Publisher safety_zone_pub_; ///< Publisher for the index of the violated protective zone (-1 if none)
+    bool safety_enabled_; ///< True if protective zones have been loaded
+    bool safety_before_scan_; ///< Publish the safety state before the scan is assembled
+    int pending_safety_; ///< Safety state of the current frame, published after the scan (-2 if it wasn't checked)
+    ros::Publisher quality_pub_; ///< Latched publisher for the current quality level of the conversion
+    ros::Publisher diag_pub_; ///< Publisher for the data-quality diagnostics; counters are only collected while subscribed
+    ScanDiagnostics diagnostics_; ///< Aggregates the data-quality counters of the conversions
     dynamic_reconfigure::Server<DepthConfig> srv_; ///< Dynamic reconfigure server
     
     boost::mutex config_mutex_;
     
     DepthImageToLaserScan dtl_; ///< Instance of the DepthImageToLaserScan conversion class.
-    int approach_;
+    QualityScheduler scheduler_; ///< Degrades the conversion quality to stay within the time budget.
+    int approach_; ///< Requested conversion kernel (see DepthImageToLaserScan::Kernel).
+    int reported_kernel_; ///< Kernel last reported in the selected_kernel parameter.
+    DepthConfig config_; ///< Current configuration, for reporting selected_kernel.
     boost::mutex connect_mutex_; ///< Prevents the connectCb and disconnectCb from being called until everything is initialized.
   };
   
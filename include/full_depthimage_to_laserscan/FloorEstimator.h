@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_FLOOR_ESTIMATOR
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_FLOOR_ESTIMATOR
+
+#include <sensor_msgs/Image.h>
+#include <image_geometry/pinhole_camera_model.h>
+#include <ros/ros.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Estimates the height and downward tilt (pitch) of the camera above the floor plane in the background.
+   *
+   * At a low rate, a frame offered by the conversion is handed to a background thread, which fits the floor plane to a
+   * sparse grid of pixels with RANSAC and refines it by least squares on the inliers. Only points near the current
+   * estimate are considered and candidate planes must stay within a few degrees of it, so walls and large obstacles
+   * are not mistaken for the floor. Accepted fits are smoothed, and a new estimate is only reported once it moved
+   * noticeably, so the conversion tables are not rebuilt for noise. The conversion never waits for the estimator.
+   */
+  class FloorEstimator
+  {
+  public:
+    struct Plane
+    {
+      float height; ///< Distance (in meters) of the camera above the floor
+      float tilt; ///< Downward pitch (in radians) of the optical axis
+    };
+
+    FloorEstimator();
+    ~FloorEstimator();
+
+    /**
+     * @param enabled True to run the estimator.
+     * @param rate Maximum number of estimates per second.
+     *
+     */
+    void configure(const bool enabled, const double rate);
+
+    /**
+     * Offers a frame to the estimator; it is only kept if an estimate is due and the thread is idle.
+     *
+     * @param depth_msg UInt16 or Float32 encoded depth image; it is referenced, not copied.
+     * @param cam_model Camera model of the image.
+     * @param initial Configured height and tilt; the estimate restarts from them whenever they change.
+     * @param rotation Rotation (see rotated_view) of the image that cam_model describes.
+     *
+     */
+    void offer(const sensor_msgs::ImageConstPtr& depth_msg, const image_geometry::PinholeCameraModel& cam_model,
+               const Plane& initial, const int rotation = 0)
+    {
+      offer(depth_msg, depth_msg->data.data(), depth_msg, cam_model, initial, rotation);
+    }
+
+    /**
+     * Offers a frame whose pixels live outside of a sensor_msgs::Image (e.g. in a pooled buffer).
+     *
+     * @param depth_msg Header, size, step and encoding of the frame; its data is not used.
+     * @param pixels The pixels of the frame.
+     * @param owner Keeps the pixels alive for as long as the estimator references them.
+     *
+     */
+    void offer(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* pixels,
+               const boost::shared_ptr<const void>& owner, const image_geometry::PinholeCameraModel& cam_model,
+               const Plane& initial, const int rotation = 0);
+
+    /**
+     * Returns the smoothed estimate if it changed since the last call.
+     *
+     * @param plane Output: the current estimate.
+     * @return True if plane was set.
+     *
+     */
+    bool poll(Plane& plane);
+
+  private:
+    /**
+     * Intrinsics needed to back-project the pixels of a frame.
+     */
+    struct Intrinsics
+    {
+      double fx, fy, cx, cy;
+      int rotation;
+    };
+
+    void work();
+
+    /**
+     * Fits the floor plane to a frame.
+     *
+     * @return False if no plane close enough to the prior is supported by enough pixels.
+     */
+    bool fit(const sensor_msgs::Image& depth_msg, const uint8_t* pixels, const Intrinsics& intrinsics,
+             const Plane& prior, Plane& plane);
+
+    /**
+     * Collects the back-projected points of a sparse pixel grid that lie near the prior floor plane.
+     */
+    template<typename T>
+    void sample_points(const sensor_msgs::Image& depth_msg, const uint8_t* pixels, const Intrinsics& intrinsics,
+                       const Plane& prior);
+
+    boost::thread thread_;
+    boost::mutex mutex_; ///< Protects the members below up to points_
+    boost::condition_variable wake_;
+    bool enabled_;
+    bool stopped_;
+    bool busy_; ///< True while the thread is fitting a frame
+    double period_; ///< Minimum time (in seconds) between estimates
+    ros::WallTime next_; ///< Earliest time of the next estimate
+    sensor_msgs::ImageConstPtr frame_; ///< Frame waiting to be fitted
+    const uint8_t* frame_pixels_; ///< Pixels of frame_
+    boost::shared_ptr<const void> frame_owner_; ///< Keeps frame_pixels_ alive
+    Intrinsics intrinsics_;
+    Plane initial_; ///< Configured plane the estimate started from
+    Plane plane_; ///< Smoothed estimate
+    Plane reported_; ///< Estimate last returned by poll
+    bool changed_; ///< True if plane_ moved noticeably since it was last reported
+
+    std::vector<float> points_; ///< x, y, z of the sampled points (only used by the thread)
+    uint32_t seed_; ///< State of the random generator (only used by the thread)
+  };
+
+}; // full_depthimage_to_laserscan
+
+#endif
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_GEOMETRY_REGISTRY
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_GEOMETRY_REGISTRY
+
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+
+namespace full_depthimage_to_laserscan
+{
+  struct GeometryTables;
+  struct LimitTables;
+
+  /**
+   * Process-wide registry of the immutable conversion tables, shared by all converters of the same camera.
+   *
+   * Converters that see the same calibration and encoding (e.g. several bands of one camera in a nodelet manager) get
+   * the same GeometryTables, and those that also use the same floor/overhead limits share their LimitTables, instead
+   * of each building and holding a copy. Entries are reference counted: the registry only keeps weak references, so
+   * tables are freed as soon as the last converter using them moves on to another calibration or is destroyed.
+   *
+   * The tables must not be modified once they have been handed out. All functions are thread-safe.
+   */
+  class GeometryRegistry
+  {
+  public:
+    typedef boost::shared_ptr<const GeometryTables> GeometryTablesConstPtr;
+    typedef boost::shared_ptr<const LimitTables> LimitTablesConstPtr;
+
+    /**
+     * Returns the registry of the process.
+     */
+    static GeometryRegistry& instance();
+
+    /**
+     * Returns the geometry tables registered under key, calling build (without holding the registry's lock) to create
+     * them if there are none.
+     */
+    GeometryTablesConstPtr geometry(const std::string& key,
+                                    const boost::function<boost::shared_ptr<GeometryTables> ()>& build);
+
+    /**
+     * Returns the limit tables registered under key, calling build to create them if there are none.
+     */
+    LimitTablesConstPtr limits(const std::string& key, const boost::function<boost::shared_ptr<LimitTables> ()>& build);
+
+    /**
+     * Returns the number of geometry and limit tables currently alive.
+     */
+    size_t size();
+
+    /**
+     * Returns a key identifying the calibration and the size and encoding of the images, to which parameter values can
+     * be appended with append_key.
+     */
+    static std::string calibration_key(const sensor_msgs::CameraInfo& info, const sensor_msgs::Image& image);
+
+    static void append_key(std::string& key, const float value);
+
+  private:
+    GeometryRegistry() {}
+
+    template<typename Tables>
+    boost::shared_ptr<const Tables> lookup(std::map<std::string, boost::weak_ptr<const Tables> >& entries,
+                                           const std::string& key,
+                                           const boost::function<boost::shared_ptr<Tables> ()>& build);
+
+    boost::mutex mutex_;
+    std::map<std::string, boost::weak_ptr<const GeometryTables> > geometry_;
+    std::map<std::string, boost::weak_ptr<const LimitTables> > limits_;
+  };
+
+}; // full_depthimage_to_laserscan
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_QUALITY_SCHEDULER
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_QUALITY_SCHEDULER
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Keeps the conversion within a per-frame time budget by degrading the quality in steps.
+   * 
+   * Each level sub-samples more rows of the band and, at the highest levels, skips frames. The level is raised when
+   * the smoothed conversion time exceeds the budget and lowered again once it has stayed well below the budget, so
+   * the scheduler recovers when the load drops. After every change the scheduler waits for the smoothed time to
+   * settle at the new level before changing again.
+   */
+  class QualityScheduler
+  {
+  public:
+    QualityScheduler();
+    
+    /**
+     * Sets the time budget for converting one frame.
+     * 
+     * @param budget Time budget (in seconds); 0 disables the scheduler and restores full quality.
+     * 
+     */
+    void set_budget(const double budget);
+    
+    /**
+     * Decides whether the current frame should be dropped to meet the budget.
+     * 
+     * Must be called once for every incoming frame.
+     * 
+     * @return True if the frame should not be converted.
+     * 
+     */
+    bool skip_frame();
+    
+    /**
+     * Reports the time taken to convert a frame and adapts the quality level.
+     * 
+     * @param latency Conversion time (in seconds).
+     * @return True if the quality level changed.
+     * 
+     */
+    bool update(const double latency);
+    
+    /**
+     * Returns the current quality level (0 = full quality).
+     */
+    int level() const;
+    
+    /**
+     * Returns the row sub-sampling to use at the current quality level.
+     */
+    int row_stride() const;
+    
+    static const int NUM_LEVELS = 5;
+    
+  private:
+    void set_level(const int level);
+    
+    double budget_; ///< Time budget per frame (in seconds); 0 if disabled.
+    double average_; ///< Exponentially smoothed conversion time (in seconds).
+    int level_; ///< Current quality level.
+    int settle_; ///< Number of frames to wait before the level may change again.
+    int frame_; ///< Frame counter used for frame skipping.
+  };
+  
+}; // full_depthimage_to_laserscan
+
+#endif
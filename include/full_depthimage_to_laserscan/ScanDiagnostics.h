@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_SCAN_DIAGNOSTICS
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_SCAN_DIAGNOSTICS
+
+#include <ros/time.h>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+#include <full_depthimage_to_laserscan/DepthImageToLaserScan.h>
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Turns the per-frame ConversionStats of one camera into periodic diagnostic reports.
+   *
+   * The counters of all frames within a period are summed and reported as fractions: of the examined pixels for the
+   * pixel counters, of the beams for the beam counters. Each fraction is also smoothed over a much longer window, and
+   * the report includes that trend and the deviation of the current period from it, so a gradual degradation (e.g. a
+   * dirty lens or a tilting mount) stands out from the usual scene-dependent variation.
+   */
+  class ScanDiagnostics
+  {
+  public:
+    ScanDiagnostics();
+
+    /**
+     * @param name Name of the reported status, typically the camera's namespace.
+     * @param period Time (in seconds) over which the counters are summed for a report.
+     * @param trend_window Time constant (in seconds) of the trend smoothing.
+     *
+     */
+    void configure(const std::string& name, const double period, const double trend_window);
+
+    /**
+     * Adds the counters of a converted frame.
+     */
+    void add(const ConversionStats& stats);
+
+    /**
+     * Creates a report if a period has passed since the previous one, and restarts the summation.
+     *
+     * @param now Current time.
+     * @param status Output: the report.
+     * @return True if a report was created.
+     *
+     */
+    bool report(const ros::Time& now, diagnostic_msgs::DiagnosticStatus& status);
+
+    enum Metric
+    {
+      INVALID_PIXELS, ///< Pixels without a measurement
+      ROW_LIMIT_PIXELS, ///< Pixels rejected as floor/overhead
+      MIN_DEPTH_PIXELS, ///< Pixels rejected by range_min
+      NO_RETURN_BEAMS, ///< Beams without a return
+      SINGLE_PIXEL_BEAMS, ///< Beams backed by a single pixel
+      NUM_METRICS
+    };
+
+  private:
+    std::string name_;
+    double period_;
+    double trend_window_;
+
+    ros::Time last_report_; ///< Time of the previous report, zero before the first one
+    int frames_; ///< Frames added in the current period
+    ConversionStats sum_; ///< Counters summed over the current period
+
+    bool trend_valid_; ///< False until the first period with frames has been reported
+    double trend_[NUM_METRICS]; ///< Exponentially smoothed fraction of each metric
+  };
+
+}; // full_depthimage_to_laserscan
+
+#endif
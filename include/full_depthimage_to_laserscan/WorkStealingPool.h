@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_WORK_STEALING_POOL
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_WORK_STEALING_POOL
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Fixed set of threads shared by several conversion streams.
+   *
+   * Each stream submits one frame task at a time; a task that hasn't started yet is replaced by a newer one, so an
+   * overloaded stream drops stale frames instead of queueing them. Idle workers pick the next stream by stride
+   * scheduling: every started frame advances the stream's pass by 1/priority, and the ready stream with the smallest
+   * pass goes first, so streams share the pool in proportion to their priorities. Frames of one stream never run
+   * concurrently.
+   *
+   * Inside a frame, run_parallel forks work onto the calling worker's deque; idle workers steal from the other end,
+   * so a busy stream can use cores the other streams leave idle. The total CPU use is bounded by the number of
+   * threads, plus the threads outside of the pool that call run_parallel.
+   */
+  class WorkStealingPool
+  {
+  public:
+    typedef boost::function<void ()> Task;
+
+    /**
+     * @param num_threads Number of worker threads.
+     */
+    explicit WorkStealingPool(const int num_threads);
+    ~WorkStealingPool();
+
+    /**
+     * Registers a stream.
+     *
+     * @param priority Relative share of the pool the stream gets when streams compete (> 0).
+     * @return Id of the stream for submit.
+     */
+    int add_stream(const double priority);
+
+    /**
+     * Schedules the frame task of a stream, replacing its previous task if that hasn't started yet.
+     */
+    void submit(const int stream, const Task& task);
+
+    /**
+     * Runs a task as a frame of the stream and waits for it to finish, e.g. for a conversion requested by a client.
+     *
+     * The task is scheduled like a submitted one, so it waits for the stream's running frame and for the streams with
+     * a smaller pass. No other frame of the stream may be submitted meanwhile, since it would replace the task.
+     *
+     * @return False if the pool was shut down before the task started; the task is then never run.
+     */
+    bool run(const int stream, const Task& task);
+
+    /**
+     * Runs tasks in parallel and returns when all of them have finished.
+     *
+     * The tasks are offered to the workers for stealing while the caller works through them as well. Called from a
+     * worker, they are forked onto its own deque; called from any other thread, onto a deque shared by such threads.
+     */
+    void run_parallel(const std::vector<Task>& tasks);
+
+    /**
+     * Stops the workers; pending frame tasks are dropped and later submissions are ignored.
+     */
+    void shutdown();
+
+    int num_threads() const;
+
+  private:
+    /**
+     * Forked jobs of a run_parallel call that haven't finished yet.
+     */
+    struct Completion
+    {
+      boost::mutex mutex;
+      boost::condition_variable done;
+      int remaining;
+    };
+
+    struct Job
+    {
+      Task task;
+      Completion* completion;
+    };
+
+    struct Worker
+    {
+      boost::mutex mutex;
+      std::deque<Job> jobs; ///< Forked jobs; the owner pops from the back, thieves steal from the front
+    };
+
+    struct Stream
+    {
+      double stride; ///< Pass increment per frame, 1/priority
+      double pass;
+      bool running;
+      Task pending;
+    };
+
+    void work(const int index);
+
+    /**
+     * Counts a job of a run_parallel call as finished and wakes the caller after the last one.
+     */
+    static void finish(const Job& job);
+
+    /**
+     * Pops a job from the worker's own deque, or steals one from another worker.
+     */
+    bool find_job(const int index, Job& job);
+
+    /**
+     * Takes the frame task of the ready stream with the smallest pass. Requires mutex_.
+     */
+    int next_stream(Task& task);
+
+    std::vector<boost::shared_ptr<Worker> > workers_; ///< One per thread, plus one for callers outside of the pool
+    boost::thread_group threads_;
+
+    boost::mutex mutex_; ///< Protects streams_, stopped_ and the wake-up condition
+    boost::condition_variable wake_;
+    boost::condition_variable finished_; ///< Notified whenever a frame task finishes, and on shutdown
+    std::vector<Stream> streams_;
+    std::atomic<int> forked_jobs_; ///< Number of jobs waiting in the workers' deques
+    bool stopped_;
+  };
+
+}; // full_depthimage_to_laserscan
+
+#endif
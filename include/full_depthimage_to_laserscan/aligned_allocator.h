@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_ALIGNED_ALLOCATOR
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_ALIGNED_ALLOCATOR
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <sys/mman.h>
+
+namespace full_depthimage_to_laserscan
+{
+  static const size_t CACHE_LINE_SIZE = 64;
+  static const size_t HUGE_PAGE_SIZE = 2 << 20;
+
+  /**
+   * Allocator for the conversion tables and buffers.
+   *
+   * Every allocation starts on a cache line and is padded to a whole number of cache lines, so the kernels' loops
+   * never straddle a line at the start of a table and vectorized loads need no peeling. Allocations of at least
+   * HUGE_PAGE_SIZE are aligned to it and advised to be backed by transparent huge pages, which saves TLB misses when
+   * streaming through large buffers.
+   */
+  template <typename T>
+  struct AlignedAllocator
+  {
+    typedef T value_type;
+
+    AlignedAllocator() {}
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U>&) {}
+
+    template <typename U>
+    struct rebind
+    {
+      typedef AlignedAllocator<U> other;
+    };
+
+    T* allocate(size_t n)
+    {
+      size_t size = (n*sizeof(T) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+      size_t alignment = (size >= HUGE_PAGE_SIZE) ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+
+      void* p = NULL;
+      if(posix_memalign(&p, alignment, size) != 0)
+      {
+        throw std::bad_alloc();
+      }
+#ifdef MADV_HUGEPAGE
+      if(alignment == HUGE_PAGE_SIZE)
+      {
+        madvise(p, size & ~(HUGE_PAGE_SIZE - 1), MADV_HUGEPAGE); // Only advisory; failure is harmless
+      }
+#endif
+      return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t)
+    {
+      free(p);
+    }
+  };
+
+  template <typename T, typename U>
+  bool operator==(const AlignedAllocator<T>&, const AlignedAllocator<U>&) { return true; }
+
+  template <typename T, typename U>
+  bool operator!=(const AlignedAllocator<T>&, const AlignedAllocator<U>&) { return false; }
+
+  /**
+   * std::vector whose data starts on a cache line.
+   */
+  template <typename T>
+  using AlignedVector = std::vector<T, AlignedAllocator<T> >;
+
+  /**
+   * Tells the compiler that a pointer into an aligned table is cache-line aligned.
+   */
+  template <typename T>
+  inline T* assume_aligned(T* p)
+  {
+    return static_cast<T*>(__builtin_assume_aligned(p, CACHE_LINE_SIZE));
+  }
+
+}; // full_depthimage_to_laserscan
+
+#endif
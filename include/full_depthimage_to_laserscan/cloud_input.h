@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_CLOUD_INPUT
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_CLOUD_INPUT
+
+#include <sensor_msgs/PointCloud2.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Strided view of the depths of an organized point cloud.
+   *
+   * The cloud must be in the optical frame of the camera that produced it (z forward, x right, y down), as published
+   * by depth_image_proc and most camera drivers, so that the z of the point of pixel (u, v) is the depth of that pixel.
+   * That depth is origin[u*col_step + v*row_step]; the cloud data is never copied.
+   */
+  struct CloudDepthView
+  {
+    const float* origin; ///< z of point (0, 0)
+    int col_step; ///< Floats between horizontally adjacent points
+    int row_step; ///< Floats between vertically adjacent points
+    int width, height; ///< Size of the cloud
+  };
+
+  /**
+   * Returns the view of the z field of the cloud.
+   *
+   * Throws std::runtime_error if the cloud is not organized, is big-endian, or has no float32 z field that can be read
+   * as an array of floats.
+   */
+  CloudDepthView cloud_depth_view(const sensor_msgs::PointCloud2& cloud);
+
+  /**
+   * Estimates the pinhole intrinsics of an organized cloud from its points, for clouds without a CameraInfo.
+   *
+   * Each valid point of pixel (u, v) satisfies u = fx*x/z + cx and v = fy*y/z + cy; both lines are fitted by least
+   * squares over a subsample of the points. The result has no distortion, so it only describes rectified clouds.
+   * Throws std::runtime_error if too few points are valid to fit them (e.g. a camera looking at nothing).
+   */
+  sensor_msgs::CameraInfoPtr estimate_camera_info(const sensor_msgs::PointCloud2& cloud);
+
+  /**
+   * Returns an image without data that has the size of the cloud and the 32FC1 encoding, for sizing the conversion
+   * tables.
+   */
+  sensor_msgs::ImagePtr cloud_image_geometry(const sensor_msgs::PointCloud2& cloud);
+
+}; // full_depthimage_to_laserscan
+
+#endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_COMPACT_SCAN
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_COMPACT_SCAN
+
+#include <full_depthimage_to_laserscan/CompactScan.h>
+#include <sensor_msgs/LaserScan.h>
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Produces a stream of CompactScan messages from millimetre ranges.
+   * 
+   * In delta mode only the beams that changed by more than the tolerance since the last message are sent, and nothing
+   * is sent if no beam changed. An absolute key frame is sent every keyframe_interval messages so that new or
+   * out-of-sync decoders can (re)start.
+   */
+  class CompactScanEncoder
+  {
+  public:
+    CompactScanEncoder();
+    
+    /**
+     * Sets the encoding parameters.
+     * 
+     * @param delta True to delta-encode messages against the previous message.
+     * @param keyframe_interval Number of messages between absolute key frames in delta mode.
+     * @param tolerance Change (in mm) below which a beam is considered unchanged.
+     * 
+     */
+    void configure(const bool delta, const int keyframe_interval, const uint16_t tolerance);
+    
+    /**
+     * Encodes the ranges of a scan.
+     * 
+     * @param scan_msg LaserScan providing the header and angular/range limits.
+     * @param ranges_mm Range of each beam (in mm, 0 = no return).
+     * @param compact_msg The output message.
+     * @return False if nothing changed and no message needs to be sent.
+     * 
+     */
+    bool encode(const sensor_msgs::LaserScan& scan_msg, const std::vector<uint16_t>& ranges_mm, CompactScan& compact_msg);
+    
+  private:
+    bool delta_;
+    int keyframe_interval_;
+    uint16_t tolerance_;
+    uint32_t sequence_; ///< Sequence number of the next message
+    int since_keyframe_; ///< Messages sent since the last key frame
+    std::vector<uint16_t> reference_; ///< Ranges as known to the decoders
+  };
+  
+  /**
+   * Reconstructs scans from a stream of CompactScan messages.
+   */
+  class CompactScanDecoder
+  {
+  public:
+    CompactScanDecoder();
+    
+    /**
+     * Applies a message to the decoder state.
+     * 
+     * @param compact_msg The received message.
+     * @param ranges_mm Output: range of each beam (in mm, 0 = no return).
+     * @return False if the ranges aren't known yet (no key frame received since start or since a lost message).
+     * 
+     */
+    bool decode(const CompactScan& compact_msg, std::vector<uint16_t>& ranges_mm);
+    
+    /**
+     * Applies a message to the decoder state and converts the result to a LaserScan.
+     * 
+     * Beams without a return are set to NaN.
+     * 
+     * @param compact_msg The received message.
+     * @param scan_msg Output: the reconstructed scan.
+     * @return False if the ranges aren't known yet.
+     * 
+     */
+    bool decode(const CompactScan& compact_msg, sensor_msgs::LaserScan& scan_msg);
+    
+  private:
+    bool synchronized_; ///< True if ranges_ is up to date with the stream
+    uint32_t sequence_; ///< Sequence number of the last applied message
+    std::vector<uint16_t> ranges_;
+  };
+  
+}; // full_depthimage_to_laserscan
+
+#endif
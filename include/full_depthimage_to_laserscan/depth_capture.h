@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_DEPTH_CAPTURE
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_DEPTH_CAPTURE
+
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Depth capture files: a depth stream stored so that it can be memory-mapped and converted in place.
+   *
+   * Layout (native byte order, i.e. little-endian on all supported platforms):
+   *
+   *   CaptureFileHeader
+   *   CameraInfo of the stream, ROS-serialized (info_size bytes)
+   *   padding up to frames_offset, a multiple of CAPTURE_PAGE_SIZE
+   *   frame 0, frame 1, ...: frame_stride bytes each, a CaptureFrameHeader padded to CAPTURE_FRAME_HEADER_SIZE,
+   *                          then height rows of step bytes, then padding to a multiple of CAPTURE_FRAME_HEADER_SIZE
+   *
+   * Frame i starts at frames_offset + i*frame_stride and its pixels start on a cache line, so they can be handed
+   * straight from the mapping to the conversion kernels. The number of frames follows from the file size; a capture
+   * whose recorder was killed loses at most its last, partially written frame. The camera calibration is assumed to
+   * be constant and stored once.
+   */
+  static const char CAPTURE_MAGIC[8] = {'D', 'T', 'L', 'C', 'A', 'P', 'T', '\0'};
+  static const uint32_t CAPTURE_VERSION = 1;
+  static const size_t CAPTURE_PAGE_SIZE = 4096;
+  static const size_t CAPTURE_FRAME_HEADER_SIZE = 64;
+
+  struct CaptureFileHeader
+  {
+    char magic[8]; ///< CAPTURE_MAGIC
+    uint32_t version; ///< CAPTURE_VERSION
+    uint32_t width, height;
+    uint32_t step; ///< Bytes per image row
+    char encoding[16]; ///< Image encoding (16UC1 or 32FC1), zero-terminated
+    uint64_t info_size; ///< Bytes of the serialized CameraInfo following this header
+    uint64_t frames_offset; ///< Offset of the first frame in the file
+    uint64_t frame_stride; ///< Bytes between the starts of consecutive frames
+  };
+
+  struct CaptureFrameHeader
+  {
+    uint64_t stamp; ///< Header stamp of the image (in nanoseconds)
+    uint32_t seq; ///< Header sequence number of the image
+    uint32_t reserved;
+  };
+
+  /**
+   * Records a depth stream to a capture file.
+   *
+   * Frames are appended with plain sequential writes; nothing needs to be finalized, so the file is valid after every
+   * frame. Errors are reported with std::runtime_error.
+   */
+  class DepthCaptureWriter
+  {
+  public:
+    DepthCaptureWriter();
+    ~DepthCaptureWriter();
+
+    /**
+     * Creates (or truncates) a capture file for frames of the size and encoding of the given image.
+     *
+     * @param path Path of the file.
+     * @param image The first frame; it is not written.
+     * @param info Calibration of the stream; stored with the header of image.
+     *
+     */
+    void open(const std::string& path, const sensor_msgs::Image& image, const sensor_msgs::CameraInfo& info);
+
+    bool is_open() const;
+
+    /**
+     * Appends a frame.
+     *
+     * @return False (and nothing is written) if the size, step or encoding of the image differ from the capture's.
+     */
+    bool write(const sensor_msgs::Image& image);
+
+    void close();
+
+    /**
+     * Returns the number of frames written.
+     */
+    uint64_t num_frames() const;
+
+  private:
+    int fd_;
+    CaptureFileHeader header_;
+    uint64_t num_frames_;
+    std::vector<uint8_t> record_; ///< Frame being written, frame_stride bytes
+  };
+
+  /**
+   * Memory-maps a capture file and gives zero-copy access to its frames.
+   *
+   * The pixels of a frame are returned as a pointer into the mapping, to be passed to
+   * DepthImageToLaserScan::convert_buffer together with the header-only image describing the frame. Errors are
+   * reported with std::runtime_error.
+   */
+  class DepthCaptureReader
+  {
+  public:
+    DepthCaptureReader();
+    ~DepthCaptureReader();
+
+    /**
+     * Maps a capture file.
+     *
+     * @param path Path of the file.
+     * @param preload True to read the whole file into memory up front, so that iterating over the frames (e.g. in a
+     * benchmark loop) does no I/O and takes no page faults.
+     *
+     */
+    void open(const std::string& path, const bool preload = true);
+
+    void close();
+
+    size_t num_frames() const;
+
+    /**
+     * Returns the calibration of the stream.
+     */
+    const sensor_msgs::CameraInfoConstPtr& camera_info() const;
+
+    /**
+     * Returns an image without data that describes the frames (size, step, encoding and frame_id).
+     */
+    sensor_msgs::ImagePtr image() const;
+
+    /**
+     * Returns the pixels of a frame, valid until the reader is closed.
+     *
+     * @param i Index of the frame.
+     * @param image Output: its stamp and seq are set to the frame's.
+     *
+     */
+    const uint8_t* frame(const size_t i, sensor_msgs::Image& image) const;
+
+  private:
+    const uint8_t* map_; ///< The mapped file, NULL if closed
+    size_t size_; ///< Size of the mapping
+    CaptureFileHeader header_;
+    size_t num_frames_;
+    sensor_msgs::CameraInfoConstPtr info_;
+  };
+
+}; // full_depthimage_to_laserscan
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_IMAGE_ROTATION
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_IMAGE_ROTATION
+
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Strided view of an image as if the camera had been mounted upright.
+   *
+   * The rotation is the clockwise rotation (0, 90, 180 or 270 degrees) that turns the image upright. Pixel (u, v) of
+   * the rotated image is origin[u*col_step + v*row_step]; the image data is never copied.
+   */
+  template<typename T>
+  struct RotatedView
+  {
+    const T* origin; ///< Pixel (0, 0) of the rotated image
+    int col_step; ///< Elements between horizontally adjacent pixels of the rotated image
+    int row_step; ///< Elements between vertically adjacent pixels of the rotated image
+    int width, height; ///< Size of the rotated image
+
+    const T& operator()(const int u, const int v) const
+    {
+      return origin[u*col_step + v*row_step];
+    }
+  };
+
+  /**
+   * Returns the view of the image rotated by the given (valid) rotation.
+   *
+   * @param image Size and step of the image.
+   * @param pixels The pixels of the image (its data, or external memory).
+   * @param rotation Clockwise rotation in degrees.
+   */
+  template<typename T>
+  RotatedView<T> rotated_view(const sensor_msgs::Image& image, const uint8_t* pixels, const int rotation)
+  {
+    const T* data = reinterpret_cast<const T*>(pixels);
+    const int step = image.step / sizeof(T);
+    const int w = image.width, h = image.height;
+
+    RotatedView<T> view;
+    switch(rotation)
+    {
+      case 90: // (u, v) -> (v, h-1-u)
+        view.origin = data + (h-1)*step;
+        view.col_step = -step;
+        view.row_step = 1;
+        break;
+      case 180: // (u, v) -> (w-1-u, h-1-v)
+        view.origin = data + (h-1)*step + w-1;
+        view.col_step = -1;
+        view.row_step = -step;
+        break;
+      case 270: // (u, v) -> (w-1-v, u)
+        view.origin = data + w-1;
+        view.col_step = step;
+        view.row_step = -1;
+        break;
+      default:
+        view.origin = data;
+        view.col_step = 1;
+        view.row_step = step;
+    }
+
+    const bool transposed = (rotation == 90 || rotation == 270);
+    view.width = transposed ? h : w;
+    view.height = transposed ? w : h;
+    return view;
+  }
+
+  template<typename T>
+  RotatedView<T> rotated_view(const sensor_msgs::Image& image, const int rotation)
+  {
+    return rotated_view<T>(image, image.data.data(), rotation);
+  }
+
+  /**
+   * Returns true if the rotation is 0, 90, 180 or 270 degrees.
+   */
+  inline bool valid_rotation(const int rotation)
+  {
+    return rotation == 0 || rotation == 90 || rotation == 180 || rotation == 270;
+  }
+
+  /**
+   * Returns the calibration of the virtual camera that sees the rotated image.
+   *
+   * The focal lengths and principal point are permuted to match the rotated pixel grid. The distortion is dropped,
+   * so the rotated camera is only valid for rectified images.
+   */
+  sensor_msgs::CameraInfoPtr rotate_camera_info(const sensor_msgs::CameraInfo& info, const int rotation);
+
+  /**
+   * Returns an image without data that has the size and encoding of the rotated image, for sizing the conversion
+   * tables.
+   */
+  sensor_msgs::ImagePtr rotate_image_geometry(const sensor_msgs::Image& image, const int rotation);
+
+}; // full_depthimage_to_laserscan
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_PERF_COUNTERS
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_PERF_COUNTERS
+
+/**
+ * Hardware performance counters around the stages of the conversion.
+ *
+ * Only available if the package is built with -DPERF_COUNTERS=ON, which defines
+ * FULL_DEPTHIMAGE_TO_LASERSCAN_PERF_COUNTERS; otherwise PERF_STAGE and PERF_FRAME expand to nothing and no profiling
+ * code is compiled.
+ */
+#ifdef FULL_DEPTHIMAGE_TO_LASERSCAN_PERF_COUNTERS
+
+#include <boost/thread/thread.hpp>
+#include <atomic>
+#include <map>
+#include <stdint.h>
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Reads cycles, instructions, last-level cache misses and branch misses of the calling thread (perf_event_open)
+   * at the start and end of each stage, and periodically logs the per-stage averages.
+   *
+   * perf_event_open counts the thread that opens the counters, so they are opened by the converting thread itself at
+   * its first stage after profiling was enabled, and once per thread if frames are converted on several threads (e.g.
+   * the workers of a WorkStealingPool); those stay open until profiling is disabled. Counters that the kernel or the
+   * hardware doesn't provide (e.g. in a VM, or with a restrictive perf_event_paranoid) are left out; if not even cycles
+   * can be counted, profiling is disabled with a warning. Threads forked by the threaded kernel aren't counted.
+   *
+   * Only set_enabled and enabled may be called concurrently with a conversion.
+   */
+  class PerfProfiler
+  {
+  public:
+    enum Stage
+    {
+      STAGE_UPDATE_CACHE, ///< Checking and rebuilding the cached tables
+      STAGE_CONVERT, ///< The conversion kernel, including STAGE_ASSEMBLE
+      STAGE_ASSEMBLE, ///< Turning the column minima into the output ranges
+      NUM_STAGES
+    };
+
+    enum Counter
+    {
+      COUNTER_CYCLES,
+      COUNTER_INSTRUCTIONS,
+      COUNTER_LLC_MISSES,
+      COUNTER_BRANCH_MISSES,
+      NUM_COUNTERS
+    };
+
+    static const int REPORT_FRAMES = 100; ///< Frames averaged in each report
+
+    PerfProfiler();
+    ~PerfProfiler();
+
+    /**
+     * Requests that the counters be opened (or closed) at the next stage of the converting thread.
+     */
+    void set_enabled(const bool enabled);
+
+    bool enabled() const;
+
+    void begin(const Stage stage);
+    void end(const Stage stage);
+
+    /**
+     * Completes a frame and logs the averages every REPORT_FRAMES frames.
+     *
+     * @param pixels Number of pixels the frame's conversion examined.
+     */
+    void end_frame(const uint64_t pixels);
+
+    /**
+     * Counts the enclosing scope as a stage.
+     */
+    class Scope
+    {
+    public:
+      Scope(PerfProfiler& profiler, const Stage stage): profiler_(profiler), stage_(stage)
+      {
+        profiler_.begin(stage_);
+      }
+
+      ~Scope()
+      {
+        profiler_.end(stage_);
+      }
+
+    private:
+      PerfProfiler& profiler_;
+      const Stage stage_;
+    };
+
+  private:
+    /**
+     * Counters of one converting thread.
+     */
+    struct Counters
+    {
+      int leader; ///< File descriptor of the group leader (cycles)
+      int fds[NUM_COUNTERS]; ///< File descriptor of each counter, -1 if unavailable
+      int positions[NUM_COUNTERS]; ///< Position of each counter in a group read, -1 if unavailable
+      int num_open;
+    };
+
+    /**
+     * Returns the counters of the calling thread, opening them if needed, or NULL if profiling is disabled.
+     */
+    Counters* thread_counters();
+
+    /**
+     * Opens the counters of the calling thread. Returns false if not even cycles can be counted.
+     */
+    static bool open(Counters& counters);
+
+    void close();
+
+    /**
+     * Reads the current values of the counters into values (unavailable counters read as 0).
+     */
+    static bool read(const Counters& counters, uint64_t* values);
+
+    std::atomic<bool> requested_; ///< Set by set_enabled, cleared if the counters fail
+    std::map<boost::thread::id, Counters> counters_; ///< Open counters of each converting thread
+    Counters* running_[NUM_STAGES]; ///< Counters read at the start of each running stage, NULL if not counted
+
+    uint64_t start_[NUM_STAGES][NUM_COUNTERS]; ///< Counter values at the start of the running stage
+    uint64_t totals_[NUM_STAGES][NUM_COUNTERS]; ///< Counts accumulated since the last report
+    uint64_t pixels_; ///< Pixels converted since the last report
+    int frames_; ///< Frames converted since the last report
+  };
+
+}; // full_depthimage_to_laserscan
+
+#define PERF_STAGE(profiler, stage) PerfProfiler::Scope perf_stage_scope_(profiler, PerfProfiler::stage)
+#define PERF_FRAME(profiler, pixels) profiler.end_frame(pixels)
+
+#else
+
+#define PERF_STAGE(profiler, stage)
+#define PERF_FRAME(profiler, pixels)
+
+#endif
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_POOLED_IMAGE
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_POOLED_IMAGE
+
+#include <sensor_msgs/Image.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace full_depthimage_to_laserscan
+{
+  /**
+   * Process-wide pool of the large buffers of incoming images.
+   *
+   * Buffers of at least MIN_POOLED_SIZE bytes are kept when their message is destroyed and handed out again for the
+   * next message of the same size, so a stream of frames reuses a few buffers instead of allocating and faulting in
+   * fresh pages for every frame. Smaller allocations (strings, headers) bypass the pool. All buffers are cache-line
+   * aligned (see AlignedAllocator). All functions are thread-safe.
+   */
+  class ImageBufferPool
+  {
+  public:
+    static const size_t MIN_POOLED_SIZE = 64 << 10;
+    static const size_t MAX_POOLED_BUFFERS = 8; ///< Free buffers kept; the oldest is released beyond that
+
+    /**
+     * Returns the pool of the process.
+     */
+    static ImageBufferPool& instance();
+
+    void* allocate(const size_t size);
+
+    void deallocate(void* p, const size_t size);
+
+    /**
+     * Returns the number of free buffers held by the pool.
+     */
+    size_t size();
+
+  private:
+    ImageBufferPool() {}
+
+    boost::mutex mutex_;
+    std::vector<std::pair<size_t, void*> > free_; ///< Free buffers and their sizes, oldest first
+  };
+
+  /**
+   * Allocator of the messages deserialized into pooled buffers.
+   *
+   * Besides drawing on ImageBufferPool, it default-initializes instead of value-initializing, so that resizing the
+   * data of a message before deserialization copies the pixels in doesn't clear the buffer first. Only use it for
+   * containers whose elements are all written right after they are resized.
+   */
+  template <typename T>
+  struct PooledAllocator
+  {
+    typedef T value_type;
+
+    PooledAllocator() {}
+
+    template <typename U>
+    PooledAllocator(const PooledAllocator<U>&) {}
+
+    template <typename U>
+    struct rebind
+    {
+      typedef PooledAllocator<U> other;
+    };
+
+    T* allocate(size_t n)
+    {
+      return static_cast<T*>(ImageBufferPool::instance().allocate(n*sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+      ImageBufferPool::instance().deallocate(p, n*sizeof(T));
+    }
+
+    template <typename U>
+    void construct(U* p)
+    {
+      ::new(static_cast<void*>(p)) U; // Default-initialization: pixels are left as they are
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+      ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+  };
+
+  template <typename T, typename U>
+  bool operator==(const PooledAllocator<T>&, const PooledAllocator<U>&) { return true; }
+
+  template <typename T, typename U>
+  bool operator!=(const PooledAllocator<T>&, const PooledAllocator<U>&) { return false; }
+
+  /**
+   * sensor_msgs/Image whose data is deserialized into a pooled buffer without being cleared first. It has the same
+   * message traits and wire format as sensor_msgs::Image, so it can be subscribed to on the same topics.
+   */
+  typedef sensor_msgs::Image_<PooledAllocator<void> > PooledImage;
+  typedef boost::shared_ptr<const PooledImage> PooledImageConstPtr;
+
+  /**
+   * Returns an image without data that has the header, size, step and encoding of the pooled image, to convert it
+   * with DepthImageToLaserScan::convert_buffer.
+   */
+  sensor_msgs::ImagePtr pooled_image_geometry(const PooledImage& image);
+
+}; // full_depthimage_to_laserscan
+
+#endif
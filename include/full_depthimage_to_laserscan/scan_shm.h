@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#ifndef FULL_DEPTH_IMAGE_TO_LASERSCAN_SCAN_SHM
+#define FULL_DEPTH_IMAGE_TO_LASERSCAN_SCAN_SHM
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Shared-memory scan output for consumers on the same machine that don't use ROS.
+ *
+ * The converter writes every scan into a ring of slots in a POSIX shared-memory object (shm_open). Each slot is
+ * protected by a seqlock: its sequence number is odd while the slot is being written, so readers never block the
+ * writer and detect torn reads by comparing the sequence number before and after copying. With several slots the
+ * writer is filling the slot after the latest one, so reading the latest scan practically never has to retry.
+ *
+ * This header and the FullDepthImageToLaserScanShm library have no ROS dependency; consumers only need to link that
+ * library (and librt).
+ */
+
+namespace full_depthimage_to_laserscan
+{
+  static const char SCAN_SHM_MAGIC[8] = {'D', 'T', 'L', 'S', 'C', 'A', 'N', '\0'};
+  static const uint32_t SCAN_SHM_VERSION = 1;
+
+  /**
+   * Metadata of a scan in the ring; same meaning and units as in sensor_msgs/LaserScan.
+   */
+  struct ShmScanInfo
+  {
+    uint64_t index; ///< Number of scans written before this one
+    uint64_t stamp; ///< Header stamp (in nanoseconds)
+    uint32_t seq; ///< Header sequence number
+    uint32_t num_beams; ///< Number of ranges
+    float angle_min, angle_max, angle_increment;
+    float time_increment, scan_time;
+    float range_min, range_max;
+    char frame_id[64]; ///< Header frame_id, zero-terminated (truncated if longer)
+  };
+
+  /**
+   * Header of the shared-memory object, followed by num_slots slots of slot_size bytes.
+   */
+  struct ShmRingHeader
+  {
+    char magic[8]; ///< SCAN_SHM_MAGIC, written last when the ring is created
+    uint32_t version; ///< SCAN_SHM_VERSION
+    uint32_t num_slots;
+    uint32_t max_beams; ///< Capacity of each slot (in ranges)
+    uint32_t slot_size; ///< Bytes per slot, a multiple of 64
+    std::atomic<uint32_t> closed; ///< Nonzero once the writer has closed or replaced the ring
+    uint32_t reserved;
+    std::atomic<uint64_t> written; ///< Number of scans written; the latest is in slot (written-1) % num_slots
+  };
+
+  /**
+   * Creates a ring and writes scans into it (single writer).
+   *
+   * Errors are reported with std::runtime_error.
+   */
+  class ScanShmWriter
+  {
+  public:
+    ScanShmWriter();
+    ~ScanShmWriter();
+
+    /**
+     * Creates the shared-memory object, or reuses it if it has the same layout, so that readers keep working across
+     * restarts of the writer. An object with another layout is marked closed and replaced.
+     *
+     * @param name Name of the object (e.g. "/depth_scan").
+     * @param num_slots Number of slots in the ring (at least 2).
+     * @param max_beams Largest number of ranges of a scan.
+     *
+     */
+    void open(const std::string& name, const uint32_t num_slots, const uint32_t max_beams);
+
+    bool is_open() const;
+
+    /**
+     * Returns the largest number of ranges that fits in a slot.
+     */
+    uint32_t max_beams() const;
+
+    /**
+     * Publishes a scan to the readers.
+     *
+     * @param info Metadata of the scan; index and num_beams are overwritten.
+     * @param ranges The ranges; at most max_beams are written.
+     * @param num_beams Number of ranges.
+     *
+     */
+    void write(const ShmScanInfo& info, const float* ranges, const uint32_t num_beams);
+
+    /**
+     * Marks the ring closed (readers can tell that no more scans will come) and unmaps it. The object itself is left
+     * in place for the next writer.
+     */
+    void close();
+
+  private:
+    std::string name_;
+    uint8_t* map_; ///< The mapped object, NULL if closed
+    size_t size_;
+    ShmRingHeader* header_;
+  };
+
+  /**
+   * Reads scans from a ring (any number of readers, in any processes).
+   *
+   * All functions are wait-free for the writer and only copy the requested scan. Errors are reported with
+   * std::runtime_error.
+   */
+  class ScanShmReader
+  {
+  public:
+    ScanShmReader();
+    ~ScanShmReader();
+
+    /**
+     * Maps the ring.
+     *
+     * @param name Name of the object, as given to the writer.
+     *
+     */
+    void open(const std::string& name);
+
+    void close();
+
+    bool is_open() const;
+
+    /**
+     * Returns true if the writer closed the ring or replaced it with one of another layout; reopen it to follow the
+     * new writer.
+     */
+    bool closed() const;
+
+    /**
+     * Returns the number of scans written so far.
+     */
+    uint64_t written() const;
+
+    /**
+     * Copies the latest scan.
+     *
+     * @param info Output: metadata of the scan.
+     * @param ranges Output: ranges of the scan; its capacity is reused, so reading doesn't allocate after the first
+     * scan.
+     * @return False if nothing has been written yet.
+     *
+     */
+    bool read_latest(ShmScanInfo& info, std::vector<float>& ranges) const;
+
+    /**
+     * Copies the scan with the given index, to consume every scan in order.
+     *
+     * @return False if the scan hasn't been written yet or has already been overwritten (the reader fell more than
+     * num_slots scans behind).
+     *
+     */
+    bool read(const uint64_t index, ShmScanInfo& info, std::vector<float>& ranges) const;
+
+  private:
+    const uint8_t* map_; ///< The mapped object, NULL if closed
+    size_t size_;
+    const ShmRingHeader* header_;
+  };
+
+}; // full_depthimage_to_laserscan
+
+#endif
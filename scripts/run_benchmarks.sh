@@ -0,0 +1,23 @@
+#!/bin/bash
+# Runs the end-to-end latency benchmark (launch/benchmark.launch) over a set of configurations and prints the results
+# as CSV. Everything runs locally; a roscore is started by roslaunch if none is running.
+#
+# Usage: run_benchmarks.sh [output.csv]
+
+OUTPUT=${1:-$(mktemp /tmp/dtl_benchmark_XXXX.csv)}
+echo "label,received,expected,throughput_hz,p50_ms,p99_ms,max_ms,drop_rate" > "$OUTPUT"
+
+for VARIANT in node nodelet; do
+  for RESOLUTION in 320x240 640x480 848x480 1280x720; do
+    for ENCODING in 16UC1 32FC1; do
+      for RATE in 30 60; do
+        WIDTH=${RESOLUTION%x*}
+        HEIGHT=${RESOLUTION#*x}
+        roslaunch full_depthimage_to_laserscan benchmark.launch variant:=$VARIANT width:=$WIDTH height:=$HEIGHT \
+          encoding:=$ENCODING rate:=$RATE output:="$OUTPUT" > /dev/null 2>&1
+      done
+    done
+  done
+done
+
+column -s, -t < "$OUTPUT"
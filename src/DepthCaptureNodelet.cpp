@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/depth_capture.h>
+#include <image_transport/image_transport.h>
+#include <nodelet/nodelet.h>
+#include <boost/thread/mutex.hpp>
+
+
+namespace full_depthimage_to_laserscan
+{
+
+/**
+ * Records the depth stream on "image" (with its camera_info) to a capture file (see depth_capture.h) that
+ * capture_benchmark and DepthCaptureReader can replay without ROS.
+ *
+ * The file is created at ~file when the first frame arrives. Frames whose size or encoding differ from the first one
+ * are skipped. Recording stops after ~max_frames frames (0 records until shutdown).
+ */
+class DepthCaptureNodelet : public nodelet::Nodelet
+{
+public:
+  DepthCaptureNodelet() : max_frames(0) {};
+
+  ~DepthCaptureNodelet()
+  {
+    sub.shutdown();
+    if(writer.is_open())
+    {
+      NODELET_INFO_STREAM("Recorded " << writer.num_frames() << " frames to " << path);
+    }
+  }
+
+private:
+  virtual void onInit()
+  {
+    ros::NodeHandle& pnh = getPrivateNodeHandle();
+
+    if(!pnh.getParam("file", path) || path.empty())
+    {
+      NODELET_ERROR("The ~file parameter must name the capture file to write");
+      return;
+    }
+    pnh.getParam("max_frames", max_frames);
+
+    it.reset(new image_transport::ImageTransport(getNodeHandle()));
+    image_transport::TransportHints hints("raw", ros::TransportHints(), pnh);
+    sub = it->subscribeCamera("image", 100, &DepthCaptureNodelet::depthCb, this, hints);
+  };
+
+  void depthCb(const sensor_msgs::ImageConstPtr& depth_msg, const sensor_msgs::CameraInfoConstPtr& info_msg)
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    if(max_frames > 0 && writer.num_frames() >= (uint64_t)max_frames)
+    {
+      return;
+    }
+
+    try
+    {
+      if(!writer.is_open())
+      {
+        writer.open(path, *depth_msg, *info_msg);
+        NODELET_INFO_STREAM("Recording " << depth_msg->width << "x" << depth_msg->height << " " <<
+                            depth_msg->encoding << " frames to " << path);
+      }
+      if(!writer.write(*depth_msg))
+      {
+        NODELET_WARN_THROTTLE(1.0, "Skipping a frame whose size or encoding differs from the capture's");
+      }
+    }
+    catch(std::runtime_error& e)
+    {
+      NODELET_ERROR_STREAM("Stopped recording: " << e.what());
+      writer.close();
+      sub.shutdown();
+      return;
+    }
+
+    if(max_frames > 0 && writer.num_frames() >= (uint64_t)max_frames)
+    {
+      NODELET_INFO_STREAM("Recorded " << writer.num_frames() << " frames to " << path);
+      writer.close();
+      sub.shutdown();
+    }
+  }
+
+  std::string path;
+  int max_frames;
+  boost::shared_ptr<image_transport::ImageTransport> it;
+  image_transport::CameraSubscriber sub;
+  boost::mutex mutex;
+  DepthCaptureWriter writer;
+};
+
+}
+
+#include <pluginlib/class_list_macros.h>
+PLUGINLIB_DECLARE_CLASS(depthimage_to_laserscan, DepthCaptureNodelet, full_depthimage_to_laserscan::DepthCaptureNodelet, nodelet::Nodelet);
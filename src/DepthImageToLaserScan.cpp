@@ -34,8 +34,59 @@
 #include <full_depthimage_to_laserscan/DepthImageToLaserScan.h>
 
 using namespace full_depthimage_to_laserscan;
+
+const int DepthImageToLaserScan::AUTOTUNE_ROUNDS;
+const int DepthImageToLaserScan::INCREMENTAL_STRIP_WIDTH;
+const int DepthImageToLaserScan::INCREMENTAL_SAMPLE_INTERVAL;
+const int DepthImageToLaserScan::QUANTIZED_FAR;
+const int DepthImageToLaserScan::QUANTIZED_REJECTED;
+const int DepthImageToLaserScan::QUANTIZED_BLOCK_ROWS;
+
+namespace
+{
+  /**
+   * Sets the pixels of the mono8 mask whose bits are set in the bit-packed obstacle mask (see mask_groups).
+   */
+  template<typename Word>
+  void expand_mask(const Word* groups, const int width, const int num_rows, const int offset, const int row_stride, 
+                   sensor_msgs::Image& mask)
+  {
+    const int bits = 8*sizeof(Word);
+    for(int v = 0; v < num_rows; ++v)
+    {
+      const Word* group = groups + (v/bits)*width;
+      uint8_t* row = mask.data.data() + (offset + v*row_stride)*mask.step;
+      for(int u = 0; u < width; ++u)
+      {
+        row[u] = ((group[u] >> (v%bits)) & 1) ? 255 : 0;
+      }
+    }
+  }
+}
   
-DepthImageToLaserScan::DepthImageToLaserScan(){
+DepthImageToLaserScan::DepthImageToLaserScan():
+  tilt_(0), floor_estimation_(false), floor_margin_(0.02), floor_estimate_valid_(false), 
+  min_support_(1), support_tolerance_(0), safety_min_columns_(1), safety_zones_changed_(false), incremental_(false), incremental_tolerance_(0.01), incremental_refresh_(30), 
+  quantize_(false), row_stride_(1), undistort_(false), rotation_(0), rotated_source_rotation_(0), grid_resolution_(0.05), grid_size_(0), 
+  num_threads_(std::max(std::min((int)boost::thread::hardware_concurrency(), 4), 2))
+{
+  cache_.grid_resolution = 0;
+  cache_.grid_range = 0;
+  cache_.grid_size = 0;
+  cache_.tilt = 0;
+  cache_.undistort = false;
+  cache_.incremental = false;
+  cache_.quantize = false;
+  cache_.incremental_valid = false;
+  cache_.safety_zones = 0;
+  cache_.safety_range = 0;
+  cache_.last_minima = NULL;
+  cache_.disparity_ft = 0;
+  collect_stats_ = false;
+  stats_valid_ = false;
+  collect_mask_ = false;
+  mask_valid_ = false;
+  reset_autotune();
 }
 
 DepthImageToLaserScan::~DepthImageToLaserScan(){
@@ -90,9 +141,9 @@ void DepthImageToLaserScan::updateCache()
   const sensor_msgs::CameraInfoConstPtr info_msg;
   
   //Can only update cache if we know what the previous conditions were
-  if(cache_.limits)
+  if(cache_.limit_tables)
   {
-    updateCache(cache_.limits, info_msg);
+    updateCache(cache_.limit_tables->limits, info_msg);
   }
 }
 
@@ -103,6 +154,8 @@ void DepthImageToLaserScan::updateCache(const sensor_msgs::ImageConstPtr& depth_
   bool buffer_size_changed=false;
   bool safe_limits_changed=false;
   bool range_min_changed=false;
+  bool grid_changed=false;
+  bool undistort_changed=false;
   
   //First, determine if camera parameters have changed:
   if(info_msg && cam_model_.fromCameraInfo(info_msg))
@@ -111,17 +164,18 @@ void DepthImageToLaserScan::updateCache(const sensor_msgs::ImageConstPtr& depth_
     camera_params_changed=true;
   }
   
-  if(depth_msg && cache_.limits && depth_msg->encoding != cache_.limits->encoding)
+  if(depth_msg && cache_.limit_tables && depth_msg->encoding != cache_.limit_tables->limits->encoding)
   {
     data_type_changed=true;
   }
   
-  if(scan_height_ != cache_.scan_height)
+  if(scan_height_ != cache_.scan_height || min_support_ != cache_.min_support || incremental_ != cache_.incremental || 
+    quantize_ != cache_.quantize)
   {
     buffer_size_changed=true;
   }
   
-  if(floor_dist_ != cache_.floor_dist || overhead_dist_!=cache_.overhead_dist)
+  if(effective_floor_dist() != cache_.floor_dist || overhead_dist_!=cache_.overhead_dist || effective_tilt() != cache_.tilt)
   {
     safe_limits_changed=true;
   }
@@ -131,13 +185,24 @@ void DepthImageToLaserScan::updateCache(const sensor_msgs::ImageConstPtr& depth_
     range_min_changed=true;
   }
   
+  if(undistort_ != cache_.undistort)
+  {
+    undistort_changed=true;
+  }
+  
+  if(grid_size_ != cache_.grid_size || grid_resolution_ != cache_.grid_resolution || 
+    (grid_size_ > 0 && range_max_ != cache_.grid_range))
+  {
+    grid_changed=true;
+  }
+  
   if(camera_params_changed || safe_limits_changed || data_type_changed)
   {
     ROS_INFO_STREAM("Updating safe limits");
     update_limits(depth_msg);
   }
   
-  if(camera_params_changed)
+  if(camera_params_changed || data_type_changed)
   {
     ROS_INFO_STREAM("Updating mapping");
     update_mapping(depth_msg);
@@ -153,18 +218,593 @@ void DepthImageToLaserScan::updateCache(const sensor_msgs::ImageConstPtr& depth_
   {
     ROS_INFO_STREAM("Updating buffer");
     update_buffer(depth_msg);
+    reset_autotune(); // The fastest kernel depends on the resolution, encoding and band size
+  }
+  
+  if(camera_params_changed || safe_limits_changed || range_min_changed || data_type_changed || buffer_size_changed || 
+    undistort_changed)
+  {
+    ROS_INFO_STREAM("Updating undistortion tables");
+    update_raw_tables(depth_msg);
+    if(undistort_ && min_support_ > 1)
+    {
+      ROS_WARN_STREAM("min_support " << min_support_ << " is ignored with undistort: each beam reports its nearest pixel");
+    }
+  }
+  
+  if(camera_params_changed || safe_limits_changed || range_min_changed || data_type_changed || buffer_size_changed)
+  {
+    // Column minima computed with the old limits or buffers can't be reused
+    cache_.incremental_valid = false;
+    cache_.disparity_ft = 0;
+  }
+  
+  if(camera_params_changed || data_type_changed || safety_zones_changed_ || range_max_ != cache_.safety_range)
+  {
+    ROS_INFO_STREAM("Updating safety zones");
+    update_safety(depth_msg);
+    safety_zones_changed_ = false;
+  }
+  
+  if(camera_params_changed || grid_changed)
+  {
+    ROS_INFO_STREAM("Updating grid tables");
+    update_grid(depth_msg);
+  }
+  
+
+
+}
+
+void DepthImageToLaserScan::update_beam_columns(GeometryTables& geometry, const int num_columns) const
+{
+  const int num_beams = num_columns;
+  const int sentinel = num_columns;
+  
+  // Columns feeding each beam; since the mapping is monotonic these are contiguous, but that isn't relied upon
+  std::vector<int> counts(num_beams, 0);
+  for(int u = 0; u < num_columns; ++u)
+  {
+    counts[geometry.indicies[u]]++;
+  }
+  
+  int taps = 1;
+  for(int i = 0; i < num_beams; ++i)
+  {
+    taps = std::max(taps, counts[i]);
+  }
+  
+  geometry.beam_taps = taps;
+  geometry.beam_columns.assign(taps * num_beams, sentinel);
+  std::fill(counts.begin(), counts.end(), 0);
+  
+  for(int u = 0; u < num_columns; ++u)
+  {
+    int i = geometry.indicies[u];
+    int j = counts[i]++;
+    for(; j < taps; ++j)
+    {
+      geometry.beam_columns[j * num_beams + i] = u;
+    }
+  }
+}
+
+void DepthImageToLaserScan::update_grid(const sensor_msgs::ImageConstPtr& depth_msg)
+{
+  cache_.grid_resolution = grid_resolution_;
+  cache_.grid_range = range_max_;
+  cache_.grid_size = grid_size_;
+  
+  cache_.grid_beam_offsets.clear();
+  cache_.grid_cells.clear();
+  cache_.grid_cell_ranges.clear();
+  cache_.grid_beam_extents.clear();
+  
+  if(grid_size_ <= 0)
+  {
+    return;
+  }
+  
+  const int num_beams = depth_msg->width;
+  const double angle_increment = (cache_.geometry->angle_max - cache_.geometry->angle_min) / (num_beams - 1);
+  
+  // Grid coordinates (in cells) of the sensor, which sits at the center of the grid
+  const double origin = grid_size_ / 2.0;
+  const double max_range = range_max_;
+  
+  cache_.grid_beam_offsets.resize(num_beams + 1);
+  cache_.grid_beam_extents.resize(num_beams);
+  
+  for(int i = 0; i < num_beams; ++i)
+  {
+    cache_.grid_beam_offsets[i] = cache_.grid_cells.size();
+    
+    double angle = cache_.geometry->angle_min + i * angle_increment;
+    double dx = std::cos(angle);
+    double dy = std::sin(angle);
+    
+    int cx = (int)std::floor(origin);
+    int cy = (int)std::floor(origin);
+    
+    int step_x = (dx > 0) ? 1 : -1;
+    int step_y = (dy > 0) ? 1 : -1;
+    
+    // Range (in meters) needed to cross one cell along each axis, and to reach the first cell boundary
+    double delta_x = (dx != 0) ? grid_resolution_ / std::fabs(dx) : std::numeric_limits<double>::infinity();
+    double delta_y = (dy != 0) ? grid_resolution_ / std::fabs(dy) : std::numeric_limits<double>::infinity();
+    double next_x = (dx > 0) ? (cx + 1 - origin) * delta_x : (origin - cx) * delta_x;
+    double next_y = (dy > 0) ? (cy + 1 - origin) * delta_y : (origin - cy) * delta_y;
+    
+    double range = 0;
+    while(range < max_range && cx >= 0 && cy >= 0 && cx < grid_size_ && cy < grid_size_)
+    {
+      cache_.grid_cells.push_back(cy * grid_size_ + cx);
+      cache_.grid_cell_ranges.push_back(range);
+      
+      if(next_x < next_y)
+      {
+        range = next_x;
+        next_x += delta_x;
+        cx += step_x;
+      }
+      else
+      {
+        range = next_y;
+        next_y += delta_y;
+        cy += step_y;
+      }
+    }
+    cache_.grid_beam_extents[i] = std::min(range, max_range);
+  }
+  cache_.grid_beam_offsets[num_beams] = cache_.grid_cells.size();
+}
+
+bool DepthImageToLaserScan::inside(const Polygon& polygon, const cv::Point2d& point)
+{
+  bool result = false;
+  for(size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+  {
+    const cv::Point2d& a = polygon[i];
+    const cv::Point2d& b = polygon[j];
+    if((a.y > point.y) != (b.y > point.y) && point.x < (b.x - a.x) * (point.y - a.y) / (b.y - a.y) + a.x)
+    {
+      result = !result;
+    }
+  }
+  return result;
+}
+
+bool DepthImageToLaserScan::grid_enabled() const
+{
+  return cache_.grid_size > 0 && !cache_.grid_beam_offsets.empty();
+}
+
+void DepthImageToLaserScan::convert_grid(const sensor_msgs::LaserScan& scan_msg, nav_msgs::OccupancyGrid& grid) const
+{
+  const int8_t UNKNOWN = -1, FREE = 0, OCCUPIED = 100;
+  
+  const int grid_size = cache_.grid_size;
+  const float resolution = cache_.grid_resolution;
+  
+  grid.header = scan_msg.header;
+  grid.info.map_load_time = scan_msg.header.stamp;
+  grid.info.resolution = resolution;
+  grid.info.width = grid_size;
+  grid.info.height = grid_size;
+  grid.info.origin.position.x = -grid_size * resolution / 2;
+  grid.info.origin.position.y = -grid_size * resolution / 2;
+  grid.info.origin.position.z = 0;
+  grid.info.origin.orientation.w = 1;
+  grid.data.assign(grid_size * grid_size, UNKNOWN);
+  
+  const uint32_t num_beams = std::min<uint32_t>(scan_msg.ranges.size(), cache_.grid_beam_offsets.size() - 1);
+  const uint32_t* offsets = cache_.grid_beam_offsets.data();
+  const uint32_t* cells = cache_.grid_cells.data();
+  const float* cell_ranges = cache_.grid_cell_ranges.data();
+  const float* extents = cache_.grid_beam_extents.data();
+  int8_t* data = grid.data.data();
+  
+  // Clear free space first so that a hit is never overwritten by a neighbouring beam passing through the same cell
+  for(uint32_t i = 0; i < num_beams; ++i)
+  {
+    float range = scan_msg.ranges[i];
+    if(!(range >= scan_msg.range_min))
+    {
+      continue; // NaN: no information along this beam
+    }
+    uint32_t end = offsets[i+1];
+    for(uint32_t k = offsets[i]; k < end; ++k)
+    {
+      float exit_range = (k + 1 < end) ? cell_ranges[k+1] : extents[i];
+      if(exit_range > range)
+      {
+        break;
+      }
+      data[cells[k]] = FREE;
+    }
+  }
+  
+  for(uint32_t i = 0; i < num_beams; ++i)
+  {
+    float range = scan_msg.ranges[i];
+    if(!(range >= scan_msg.range_min && range < scan_msg.range_max && range < extents[i]))
+    {
+      continue; // No return, or the return lies outside of the grid
+    }
+    uint32_t k = offsets[i];
+    uint32_t end = offsets[i+1];
+    while(k + 1 < end && cell_ranges[k+1] <= range)
+    {
+      ++k;
+    }
+    if(k < end)
+    {
+      data[cells[k]] = OCCUPIED;
+    }
+  }
+}
+
+void DepthImageToLaserScan::compact_ranges(const sensor_msgs::LaserScan& scan_msg, std::vector<uint16_t>& ranges_mm) const
+{
+  const int num_beams = scan_msg.ranges.size();
+  ranges_mm.resize(num_beams);
+  
+  if(!cache_.last_minima || cache_.column_ranges_mm.size() != (size_t)num_beams + 1)
+  {
+    for(int i = 0; i < num_beams; ++i)
+    {
+      float range = scan_msg.ranges[i];
+      ranges_mm[i] = (range == range) ? std::min(std::max(range * 1000.0f + 0.5f, 1.0f), 65534.0f) : 0;
+    }
+    return;
+  }
+  
+  const uint16_t no_return = std::numeric_limits<uint16_t>::max();
+  const uint64_t max_range = (uint64_t)DepthTraits<uint16_t>::fromMeters(scan_msg.range_max) << 15;
+  const uint16_t* minima = cache_.last_minima;
+  const uint32_t* ratios = assume_aligned(cache_.geometry->range_ratios_q15.data());
+  uint16_t* column_ranges = assume_aligned(cache_.column_ranges_mm.data());
+  
+  for(int u = 0; u < num_beams; ++u)
+  {
+    uint64_t range = (uint64_t)minima[u] * ratios[u];
+    column_ranges[u] = (range < max_range) ? std::min<uint64_t>((range + (1 << 14)) >> 15, no_return - 1) : no_return;
+  }
+  
+  // Same gather as assemble_beams
+  const int32_t* columns = cache_.geometry->beam_columns.data();
+  for(int i = 0; i < num_beams; ++i)
+  {
+    ranges_mm[i] = column_ranges[columns[i]];
+  }
+  for(int j = 1; j < cache_.geometry->beam_taps; ++j)
+  {
+    const int32_t* tap = columns + j*num_beams;
+    for(int i = 0; i < num_beams; ++i)
+    {
+      ranges_mm[i] = std::min(ranges_mm[i], column_ranges[tap[i]]);
+    }
+  }
+  for(int i = 0; i < num_beams; ++i)
+  {
+    ranges_mm[i] = (ranges_mm[i] != no_return) ? ranges_mm[i] : 0;
+  }
+}
+
+void DepthImageToLaserScan::update_disparity_tables(const float focal_baseline)
+{
+  // depth < limit  <=>  disparity > focal_baseline / limit; an infinite limit becomes 0, i.e. any positive disparity
+  const float* row_limits = cache_.limit_tables->row_limits;
+  const float* min_depth_limits = cache_.min_depth_limits;
+  const int height = cam_model_.cameraInfo().height;
+  const int width = cam_model_.cameraInfo().width;
+  
+  cache_.disparity_row_limits.resize(height);
+  for(int v = 0; v < height; ++v)
+  {
+    cache_.disparity_row_limits[v] = focal_baseline / row_limits[v];
+  }
+  
+  cache_.disparity_max_limits.resize(width);
+  for(int u = 0; u < width; ++u)
+  {
+    cache_.disparity_max_limits[u] = focal_baseline / min_depth_limits[u];
+  }
+  
+  cache_.disparity_ft = focal_baseline;
+}
+
+void DepthImageToLaserScan::convert_disparity_band(const sensor_msgs::Image& disparity, const float focal_baseline, 
+                                                   const sensor_msgs::LaserScanPtr& scan_msg) const
+{
+  const int row_step = disparity.step / sizeof(float);
+  const int offset = (int)(cam_model_.cy()-scan_height_/2);
+  const float* disparity_row = reinterpret_cast<const float*>(disparity.data.data()) + offset*row_step;
+  const float* row_limits = cache_.disparity_row_limits.data() + offset;
+  const float* max_limits = assume_aligned(cache_.disparity_max_limits.data());
+  
+  const int ranges_size = disparity.width;
+  const int row_stride = row_stride_;
+  const int num_rows = (scan_height_ + row_stride - 1)/row_stride;
+  
+  // Largest valid disparity of each column; 0 means no return (negative and NaN disparities fail the comparisons)
+  float* max_disparities = cache_.min_depths_buffer;
+  std::fill(max_disparities, max_disparities + ranges_size, 0.0f);
+  
+  const float* source = disparity_row;
+  for(int v = 0; v < num_rows; ++v, source += row_stride*row_step)
+  {
+    float row_limit = row_limits[v*row_stride];
+    for(int u = 0; u < ranges_size; ++u)
+    {
+      float d = source[u];
+      float filtered = (d > row_limit && d < max_limits[u]) ? d : 0.0f;
+      max_disparities[u] = mymax(max_disparities[u], filtered);
+    }
+  }
+  
+  // Only one divide per column; a disparity of 0 becomes an infinite depth, i.e. no return
+  float* min_depths = max_disparities;
+  for(int u = 0; u < ranges_size; ++u)
+  {
+    min_depths[u] = focal_baseline / max_disparities[u];
+  }
+  
+  assemble_columns(static_cast<const float*>(min_depths), ranges_size, scan_msg, cache_);
+}
+
+sensor_msgs::LaserScanPtr DepthImageToLaserScan::convert_disparity(const stereo_msgs::DisparityImageConstPtr& disparity_msg,
+                                                                   const sensor_msgs::CameraInfoConstPtr& info_msg)
+{
+  if(rotation_ != 0)
+  {
+    throw std::runtime_error("Rotated cameras are not supported for disparity images");
+  }
+  
+  // The conversion tables are built for the float (meters) encoding of the disparity image
+  sensor_msgs::ImageConstPtr image(disparity_msg, &disparity_msg->image);
+  if(image->encoding != sensor_msgs::image_encodings::TYPE_32FC1)
+  {
+    std::stringstream ss;
+    ss << "Disparity image has unsupported encoding: " << image->encoding;
+    throw std::runtime_error(ss.str());
+  }
+  
+  {
+    PERF_STAGE(profiler_, STAGE_UPDATE_CACHE);
+    updateCache(image, info_msg);
+  }
+  
+  const float focal_baseline = disparity_msg->f * disparity_msg->T;
+  if(focal_baseline != cache_.disparity_ft)
+  {
+    ROS_INFO_STREAM("Updating disparity tables");
+    update_disparity_tables(focal_baseline);
+  }
+  
+  sensor_msgs::LaserScanPtr scan_msg = boost::make_shared<sensor_msgs::LaserScan>();
+  scan_msg->header = disparity_msg->header;
+  if(output_frame_id_.length() > 0){
+    scan_msg->header.frame_id = output_frame_id_;
+  }
+  scan_msg->angle_min = cache_.geometry->angle_min;
+  scan_msg->angle_max = cache_.geometry->angle_max;
+  scan_msg->angle_increment = (scan_msg->angle_max - scan_msg->angle_min) / (image->width - 1);
+  scan_msg->time_increment = 0.0;
+  scan_msg->scan_time = scan_time_;
+  scan_msg->range_min = range_min_;
+  scan_msg->range_max = range_max_;
+  
+  if(scan_height_/2 > cam_model_.cy() || scan_height_/2 > image->height - cam_model_.cy()){
+    std::stringstream ss;
+    ss << "scan_height ( " << scan_height_ << " pixels) is too large for the image height.";
+    throw std::runtime_error(ss.str());
+  }
+  
+  cache_.last_minima = NULL;
+  stats_valid_ = false;
+  mask_valid_ = false;
+  
+  {
+    PERF_STAGE(profiler_, STAGE_CONVERT);
+    convert_disparity_band(*image, focal_baseline, scan_msg);
+  }
+  PERF_FRAME(profiler_, image->width * ((scan_height_ + row_stride_ - 1)/row_stride_));
+  
+  return scan_msg;
+}
+
+void DepthImageToLaserScan::convert_cloud_band(const CloudDepthView& view, const sensor_msgs::LaserScanPtr& scan_msg) const
+{
+  const int offset = (int)(cam_model_.cy()-scan_height_/2);
+  const float* depth_row = view.origin + offset*view.row_step;
+  const float* limits_row = static_cast<const float*>(cache_.limit_tables->row_limits) + offset;
+  const float* min_depth_limits = cache_.min_depth_limits;
+  
+  const int ranges_size = view.width;
+  const int row_stride = row_stride_;
+  const int num_rows = (scan_height_ + row_stride - 1)/row_stride;
+  const float big_val = DepthTraits<float>::fromMeters(range_max_+1);
+  float* min_depths = cache_.min_depths_buffer;
+  
+  switch(view.col_step)
+  {
+    case 4: // x, y, z and padding (e.g. pcl::PointXYZ)
+      reduce_cloud_band<4>(depth_row, view.col_step, view.row_step, limits_row, num_rows, row_stride, ranges_size, 
+                           big_val, min_depth_limits, min_depths);
+      break;
+    case 8: // x, y, z, padding and color or intensity (e.g. pcl::PointXYZRGB)
+      reduce_cloud_band<8>(depth_row, view.col_step, view.row_step, limits_row, num_rows, row_stride, ranges_size, 
+                           big_val, min_depth_limits, min_depths);
+      break;
+    default:
+      reduce_cloud_band<0>(depth_row, view.col_step, view.row_step, limits_row, num_rows, row_stride, ranges_size, 
+                           big_val, min_depth_limits, min_depths);
+  }
+  
+  assemble_columns(static_cast<const float*>(min_depths), ranges_size, scan_msg, cache_);
+}
+
+sensor_msgs::LaserScanPtr DepthImageToLaserScan::convert_cloud(const sensor_msgs::PointCloud2ConstPtr& cloud_msg,
+                                                               const sensor_msgs::CameraInfoConstPtr& info_msg)
+{
+  if(rotation_ != 0)
+  {
+    throw std::runtime_error("Rotated cameras are not supported for point clouds");
+  }
+  
+  const CloudDepthView view = cloud_depth_view(*cloud_msg);
+  
+  sensor_msgs::CameraInfoConstPtr camera_info = info_msg;
+  if(camera_info && (camera_info->width != cloud_msg->width || camera_info->height != cloud_msg->height))
+  {
+    // E.g. the CameraInfo of the color stream, or of a cloud that was decimated: its intrinsics would map the columns
+    // of the cloud to the wrong angles
+    ROS_WARN_STREAM_THROTTLE(10.0, "CameraInfo is " << camera_info->width << "x" << camera_info->height << 
+                             " but the point cloud is " << cloud_msg->width << "x" << cloud_msg->height << 
+                             ", estimating the intrinsics from the points instead");
+    camera_info.reset();
+  }
+  if(!camera_info)
+  {
+    if(!cloud_info_ || cloud_info_->width != cloud_msg->width || cloud_info_->height != cloud_msg->height)
+    {
+      cloud_info_ = estimate_camera_info(*cloud_msg);
+      ROS_INFO_STREAM("Estimated point cloud intrinsics: fx " << cloud_info_->K[0] << ", fy " << cloud_info_->K[4] << 
+                      ", cx " << cloud_info_->K[2] << ", cy " << cloud_info_->K[5]);
+    }
+    camera_info = cloud_info_;
+  }
+  
+  // The conversion tables are built for a float (meters) depth image of the size of the cloud
+  sensor_msgs::ImageConstPtr geometry = cloud_image_geometry(*cloud_msg);
+  {
+    PERF_STAGE(profiler_, STAGE_UPDATE_CACHE);
+    updateCache(geometry, camera_info);
   }
   
+  sensor_msgs::LaserScanPtr scan_msg = boost::make_shared<sensor_msgs::LaserScan>();
+  scan_msg->header = cloud_msg->header;
+  if(output_frame_id_.length() > 0){
+    scan_msg->header.frame_id = output_frame_id_;
+  }
+  scan_msg->angle_min = cache_.geometry->angle_min;
+  scan_msg->angle_max = cache_.geometry->angle_max;
+  scan_msg->angle_increment = (scan_msg->angle_max - scan_msg->angle_min) / (geometry->width - 1);
+  scan_msg->time_increment = 0.0;
+  scan_msg->scan_time = scan_time_;
+  scan_msg->range_min = range_min_;
+  scan_msg->range_max = range_max_;
+  
+  if(scan_height_/2 > cam_model_.cy() || scan_height_/2 > geometry->height - cam_model_.cy()){
+    std::stringstream ss;
+    ss << "scan_height ( " << scan_height_ << " pixels) is too large for the cloud height.";
+    throw std::runtime_error(ss.str());
+  }
+  
+  cache_.last_minima = NULL;
+  stats_valid_ = false;
+  mask_valid_ = false;
+  
+  {
+    PERF_STAGE(profiler_, STAGE_CONVERT);
+    convert_cloud_band(view, scan_msg);
+  }
+  PERF_FRAME(profiler_, geometry->width * ((scan_height_ + row_stride_ - 1)/row_stride_));
+  
+  return scan_msg;
+}
 
+namespace
+{
+  // Kernels timed in KERNEL_AUTO mode; the reference kernel produces different scans and is never chosen
+  const int AUTOTUNE_CANDIDATES[] = {DepthImageToLaserScan::KERNEL_HALVING, DepthImageToLaserScan::KERNEL_FUSED, 
+                                     DepthImageToLaserScan::KERNEL_THREADED};
+  const int NUM_AUTOTUNE_CANDIDATES = sizeof(AUTOTUNE_CANDIDATES)/sizeof(AUTOTUNE_CANDIDATES[0]);
+}
 
+const char* DepthImageToLaserScan::kernel_name(const int kernel)
+{
+  switch(kernel)
+  {
+    case KERNEL_AUTO: return "auto";
+    case KERNEL_REFERENCE: return "reference";
+    case KERNEL_HALVING: return "halving";
+    case KERNEL_FUSED: return "fused";
+    case KERNEL_THREADED: return "threaded";
+    default: return "unknown";
+  }
+}
+
+int DepthImageToLaserScan::tuned_kernel() const
+{
+  return tuned_kernel_;
+}
+
+void DepthImageToLaserScan::reset_autotune()
+{
+  tuned_kernel_ = KERNEL_AUTO;
+  autotune_frame_ = 0;
+  autotune_times_.assign(NUM_AUTOTUNE_CANDIDATES, std::numeric_limits<double>::infinity());
+}
+
+void DepthImageToLaserScan::record_autotune(const int kernel, const double time)
+{
+  int candidate = autotune_frame_ % NUM_AUTOTUNE_CANDIDATES;
+  autotune_times_[candidate] = std::min(autotune_times_[candidate], time); // Best of, to reject scheduling noise
+  
+  if(++autotune_frame_ < NUM_AUTOTUNE_CANDIDATES * AUTOTUNE_ROUNDS)
+  {
+    return;
+  }
+  
+  std::stringstream ss;
+  int best = 0;
+  for(int i = 0; i < NUM_AUTOTUNE_CANDIDATES; ++i)
+  {
+    if(autotune_times_[i] < autotune_times_[best])
+    {
+      best = i;
+    }
+    ss << " " << kernel_name(AUTOTUNE_CANDIDATES[i]) << "=" << autotune_times_[i] * 1e3 << "ms";
+  }
+  tuned_kernel_ = AUTOTUNE_CANDIDATES[best];
+  ROS_INFO_STREAM("Selected conversion kernel '" << kernel_name(tuned_kernel_) << "' (" << ss.str() << " )");
 }
 
 sensor_msgs::LaserScanPtr DepthImageToLaserScan::convert_msg(const sensor_msgs::ImageConstPtr& depth_msg,
       const sensor_msgs::CameraInfoConstPtr& info_msg, int approach, sensor_msgs::ImageConstPtr& image)
 {
+  return convert_buffer(depth_msg, depth_msg->data.data(), info_msg, approach, image, depth_msg);
+}
+
+sensor_msgs::LaserScanPtr DepthImageToLaserScan::convert_buffer(const sensor_msgs::ImageConstPtr& depth_msg, 
+      const uint8_t* depth_data, const sensor_msgs::CameraInfoConstPtr& info_msg, int approach, 
+      sensor_msgs::ImageConstPtr& image, const boost::shared_ptr<const void>& owner)
+{
+  // A new floor estimate only changes the limits, which updateCache then rebuilds
+  FloorEstimator::Plane plane;
+  if(floor_estimation_ && floor_estimator_.poll(plane))
+  {
+    floor_estimate_ = plane;
+    floor_estimate_valid_ = true;
+  }
+  
+  // A rotated camera is converted as the virtual upright camera; only the kernel reads the original image
+  sensor_msgs::ImageConstPtr geometry = depth_msg;
+  sensor_msgs::CameraInfoConstPtr camera_info = info_msg;
+  if(rotation_ != 0)
+  {
+    geometry = rotate_image_geometry(*depth_msg, rotation_);
+    camera_info = rotated_camera_info(info_msg);
+  }
+  
   //Update cached variables based on current image
-  updateCache(depth_msg, info_msg);
-  image=cache_.limits;
+  {
+    PERF_STAGE(profiler_, STAGE_UPDATE_CACHE);
+    updateCache(geometry, camera_info);
+  }
+  image=cache_.limit_tables->limits;
   
   // Fill in laserscan message
   sensor_msgs::LaserScanPtr scan_msg = boost::make_shared<sensor_msgs::LaserScan>();
@@ -172,61 +812,66 @@ sensor_msgs::LaserScanPtr DepthImageToLaserScan::convert_msg(const sensor_msgs::
   if(output_frame_id_.length() > 0){
     scan_msg->header.frame_id = output_frame_id_;
   }
-  scan_msg->angle_min = cache_.angle_min;
-  scan_msg->angle_max = cache_.angle_max;
-  scan_msg->angle_increment = (scan_msg->angle_max - scan_msg->angle_min) / (depth_msg->width - 1);
+  scan_msg->angle_min = cache_.geometry->angle_min;
+  scan_msg->angle_max = cache_.geometry->angle_max;
+  scan_msg->angle_increment = (scan_msg->angle_max - scan_msg->angle_min) / (geometry->width - 1);
   scan_msg->time_increment = 0.0;
   scan_msg->scan_time = scan_time_;
   scan_msg->range_min = range_min_;
   scan_msg->range_max = range_max_;
   
   // Check scan_height vs image_height
-  if(scan_height_/2 > cam_model_.cy() || scan_height_/2 > depth_msg->height - cam_model_.cy()){
+  if(scan_height_/2 > cam_model_.cy() || scan_height_/2 > geometry->height - cam_model_.cy()){
     std::stringstream ss;
     ss << "scan_height ( " << scan_height_ << " pixels) is too large for the image height.";
     throw std::runtime_error(ss.str());
   }
 
-  // Calculate and fill the ranges
-  uint32_t ranges_size = depth_msg->width;
-  scan_msg->ranges.assign(ranges_size, std::numeric_limits<float>::quiet_NaN());
+  // Calculate and fill the ranges; the kernels size them, so they are never cleared first
+  cache_.last_minima = NULL;
   
-  /*
-  if(approach==0)
+  // Undistort, incremental and min_support > 1 use their own kernels whichever is selected, so there is nothing to time
+  const bool selectable = rotation_ != 0 || (!cache_.undistort && !cache_.incremental && cache_.min_support == 1);
+  
+  int kernel = approach;
+  const bool tuning = (approach == KERNEL_AUTO && tuned_kernel_ == KERNEL_AUTO && selectable);
+  if(tuning)
   {
-    //ROS_INFO_STREAM("APPROACH 0");
-    if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1)
-    {
-      convert_old<uint16_t>(depth_msg, cam_model_, scan_msg, scan_height_);
-    }
-    else if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_32FC1)
-    {
-      convert_old<float>(depth_msg, cam_model_, scan_msg, scan_height_);
-    }
-    else
-    {
-      std::stringstream ss;
-      ss << "Depth image has unsupported encoding: " << depth_msg->encoding;
-      throw std::runtime_error(ss.str());
-    }
+    kernel = AUTOTUNE_CANDIDATES[autotune_frame_ % NUM_AUTOTUNE_CANDIDATES];
   }
-  else if(approach==1)
-    */
+  else if(approach == KERNEL_AUTO)
   {
-    if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1)
-    {
-      convert_new<uint16_t>(depth_msg, cam_model_, scan_msg, scan_height_, cache_);
-    }
-    else if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_32FC1)
-    {
-      convert_new<float>(depth_msg, cam_model_, scan_msg, scan_height_, cache_);
-    }
-    else
-    {
-      std::stringstream ss;
-      ss << "Depth image has unsupported encoding: " << depth_msg->encoding;
-      throw std::runtime_error(ss.str());
-    }
+    kernel = (tuned_kernel_ == KERNEL_AUTO) ? KERNEL_HALVING : tuned_kernel_;
+  }
+  
+  ros::WallTime start = ros::WallTime::now();
+  
+  if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_16UC1)
+  {
+    convert_kernel<uint16_t>(kernel, depth_msg, depth_data, scan_msg);
+  }
+  else if (depth_msg->encoding == sensor_msgs::image_encodings::TYPE_32FC1)
+  {
+    convert_kernel<float>(kernel, depth_msg, depth_data, scan_msg);
+  }
+  else
+  {
+    std::stringstream ss;
+    ss << "Depth image has unsupported encoding: " << depth_msg->encoding;
+    throw std::runtime_error(ss.str());
+  }
+  
+  if(tuning)
+  {
+    record_autotune(kernel, (ros::WallTime::now() - start).toSec());
+  }
+  
+  PERF_FRAME(profiler_, geometry->width * ((scan_height_ + row_stride_ - 1)/row_stride_));
+  
+  if(floor_estimation_ && owner)
+  {
+    FloorEstimator::Plane initial = {floor_dist_, tilt_};
+    floor_estimator_.offer(depth_msg, depth_data, owner, cam_model_, initial, rotation_);
   }
   
   return scan_msg;
@@ -251,6 +896,227 @@ void DepthImageToLaserScan::set_output_frame(const std::string output_frame_id){
 
 void DepthImageToLaserScan::set_filtering_limits(const float floor_dist, const float overhead_dist)
 {
+  if(floor_dist != floor_dist_)
+  {
+    floor_estimate_valid_ = false; // The estimator restarts from the new floor_dist
+  }
   floor_dist_=floor_dist;
   overhead_dist_=overhead_dist;
 }
+
+void DepthImageToLaserScan::set_camera_tilt(const float tilt)
+{
+  if(tilt != tilt_)
+  {
+    floor_estimate_valid_ = false; // The estimator restarts from the new tilt
+  }
+  tilt_ = tilt;
+}
+
+void DepthImageToLaserScan::set_floor_estimation(const bool enabled, const double rate, const float margin)
+{
+  if(enabled != floor_estimation_)
+  {
+    floor_estimate_valid_ = false; // Start over from the configured floor_dist and tilt
+  }
+  floor_estimation_ = enabled;
+  floor_margin_ = margin;
+  floor_estimator_.configure(enabled, rate);
+}
+
+bool DepthImageToLaserScan::get_floor_estimate(FloorEstimator::Plane& plane) const
+{
+  if(floor_estimation_ && floor_estimate_valid_)
+  {
+    plane = floor_estimate_;
+    return true;
+  }
+  return false;
+}
+
+float DepthImageToLaserScan::effective_floor_dist() const
+{
+  return (floor_estimation_ && floor_estimate_valid_) ? floor_estimate_.height - floor_margin_ : floor_dist_;
+}
+
+float DepthImageToLaserScan::effective_tilt() const
+{
+  return (floor_estimation_ && floor_estimate_valid_) ? floor_estimate_.tilt : tilt_;
+}
+
+void DepthImageToLaserScan::set_speckle_filter(const int min_support, const float support_tolerance)
+{
+  min_support_ = std::max(min_support, 1);
+  support_tolerance_ = support_tolerance;
+}
+
+void DepthImageToLaserScan::set_grid_geometry(const float grid_resolution, const int grid_size)
+{
+  grid_resolution_ = grid_resolution;
+  grid_size_ = std::max(grid_size, 0);
+}
+
+void DepthImageToLaserScan::set_undistort(const bool undistort)
+{
+  undistort_ = undistort;
+}
+
+void DepthImageToLaserScan::set_rotation(const int rotation)
+{
+  if(!valid_rotation(rotation))
+  {
+    ROS_ERROR_STREAM("Invalid rotation " << rotation << " (must be 0, 90, 180 or 270 degrees), keeping " << rotation_);
+    return;
+  }
+  rotation_ = rotation;
+}
+
+sensor_msgs::CameraInfoConstPtr DepthImageToLaserScan::rotated_camera_info(const sensor_msgs::CameraInfoConstPtr& info_msg)
+{
+  if(!info_msg)
+  {
+    return info_msg;
+  }
+  if(info_msg != rotated_source_ || rotation_ != rotated_source_rotation_)
+  {
+    if(undistort_)
+    {
+      ROS_WARN_ONCE("undistort is not available for rotated cameras, the image is treated as rectified");
+    }
+    rotated_info_ = rotate_camera_info(*info_msg, rotation_);
+    rotated_source_ = info_msg;
+    rotated_source_rotation_ = rotation_;
+  }
+  return rotated_info_;
+}
+
+void DepthImageToLaserScan::set_row_stride(const int row_stride)
+{
+  row_stride_ = std::max(row_stride, 1);
+}
+
+void DepthImageToLaserScan::set_incremental(const bool incremental, const float tolerance, const int refresh)
+{
+  incremental_ = incremental;
+  incremental_tolerance_ = tolerance;
+  incremental_refresh_ = std::max(refresh, 1);
+}
+
+void DepthImageToLaserScan::set_quantize(const bool quantize)
+{
+  quantize_ = quantize;
+}
+
+void DepthImageToLaserScan::set_safety_zones(const std::vector<Polygon>& zones, const int min_columns)
+{
+  safety_zones_ = zones;
+  safety_min_columns_ = std::max(min_columns, 1);
+  safety_zones_changed_ = true;
+}
+
+void DepthImageToLaserScan::set_safety_callback(const boost::function<void (int)>& callback)
+{
+  safety_cb_ = callback;
+}
+
+void DepthImageToLaserScan::set_collect_stats(const bool collect)
+{
+  collect_stats_ = collect;
+}
+
+bool DepthImageToLaserScan::get_stats(ConversionStats& stats) const
+{
+  if(stats_valid_)
+  {
+    stats = stats_;
+  }
+  return stats_valid_;
+}
+
+void DepthImageToLaserScan::set_collect_mask(const bool collect)
+{
+  collect_mask_ = collect;
+}
+
+bool DepthImageToLaserScan::get_obstacle_mask(sensor_msgs::Image& mask) const
+{
+  if(!mask_valid_)
+  {
+    return false;
+  }
+  
+  mask.header = mask_header_;
+  mask.height = mask_height_;
+  mask.width = mask_width_;
+  mask.encoding = sensor_msgs::image_encodings::MONO8;
+  mask.is_bigendian = false;
+  mask.step = mask_width_;
+  mask.data.assign(mask.step*mask.height, 0);
+  
+  if(mask_word_bits_ == 16)
+  {
+    expand_mask(static_cast<const uint16_t*>(cache_.mask_bits), mask_width_, mask_num_rows_, mask_offset_, 
+                mask_row_stride_, mask);
+  }
+  else
+  {
+    expand_mask(static_cast<const uint32_t*>(cache_.mask_bits), mask_width_, mask_num_rows_, mask_offset_, 
+                mask_row_stride_, mask);
+  }
+  return true;
+}
+
+void DepthImageToLaserScan::summarize_stats(const int ranges_size, const int num_rows, const sensor_msgs::LaserScan& scan_msg)
+{
+  const uint16_t* valid = cache_.column_counts.data();
+  const uint16_t* accepted = valid + ranges_size;
+  const uint16_t* far = accepted + ranges_size;
+  
+  ConversionStats stats = ConversionStats();
+  stats.pixels = ranges_size * num_rows;
+  stats.beams = scan_msg.ranges.size();
+  
+  beam_pixels_.assign(stats.beams, 0);
+  for(int u = 0; u < ranges_size; ++u)
+  {
+    stats.valid += valid[u];
+    stats.accepted += accepted[u];
+    stats.rejected_row_limits += far[u];
+    beam_pixels_[cache_.geometry->indicies[u]] += accepted[u];
+  }
+  stats.rejected_min_depth = stats.valid - stats.accepted - stats.rejected_row_limits;
+  
+  for(uint32_t i = 0; i < stats.beams; ++i)
+  {
+    if(std::isnan(scan_msg.ranges[i]))
+    {
+      stats.no_return_beams++;
+    }
+    else if(beam_pixels_[i] == 1)
+    {
+      stats.single_pixel_beams++;
+    }
+  }
+  
+  stats_ = stats;
+}
+
+void DepthImageToLaserScan::set_profiling(const bool profiling)
+{
+#ifdef FULL_DEPTHIMAGE_TO_LASERSCAN_PERF_COUNTERS
+  profiler_.set_enabled(profiling);
+#else
+  if(profiling)
+  {
+    ROS_WARN_ONCE("Profiling requested, but the package was built without PERF_COUNTERS");
+  }
+#endif
+}
+
+void DepthImageToLaserScan::set_parallel_executor(const ParallelExecutor& executor, const int num_threads)
+{
+  executor_ = executor;
+  thread_pool_.reset(); // Restarted with the new thread count if the executor is removed again
+  num_threads_ = executor ? std::max(num_threads, 1) : std::max(std::min((int)boost::thread::hardware_concurrency(), 4), 2);
+  reset_autotune(); // The threaded kernel performs differently now
+}
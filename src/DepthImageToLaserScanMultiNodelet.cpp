@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/DepthImageToLaserScanROS.h>
+#include <full_depthimage_to_laserscan/WorkStealingPool.h>
+#include <nodelet/nodelet.h>
+
+
+namespace full_depthimage_to_laserscan
+{
+
+/**
+ * Hosts several independent camera->scan streams that share one thread pool.
+ * 
+ * Each name in the ~streams parameter becomes a DepthImageToLaserScanROS with its topics in the <name> namespace and
+ * its parameters (including dynamic_reconfigure and ~<name>/priority) in ~<name>. All conversions run on a
+ * WorkStealingPool of ~threads threads, which bounds the total CPU use of all streams.
+ */
+class DepthImageToLaserScanMultiNodelet : public nodelet::Nodelet
+{
+public:
+  DepthImageToLaserScanMultiNodelet()  {};
+
+  ~DepthImageToLaserScanMultiNodelet()
+  {
+    // Pending conversions refer to the streams, so stop the pool before destroying them
+    if(pool)
+    {
+      pool->shutdown();
+    }
+    streams.clear();
+  }
+
+private:
+  virtual void onInit()
+  {
+    ros::NodeHandle& nh = getNodeHandle();
+    ros::NodeHandle& pnh = getPrivateNodeHandle();
+    
+    std::vector<std::string> names;
+    if(!pnh.getParam("streams", names) || names.empty())
+    {
+      NODELET_ERROR("The ~streams parameter must list the names of the camera streams");
+      return;
+    }
+    
+    int threads = boost::thread::hardware_concurrency();
+    pnh.getParam("threads", threads);
+    pool.reset(new WorkStealingPool(std::max(threads, 1)));
+    NODELET_INFO_STREAM("Converting " << names.size() << " streams on " << pool->num_threads() << " threads");
+    
+    for(size_t i = 0; i < names.size(); ++i)
+    {
+      ros::NodeHandle stream_nh(nh, names[i]);
+      ros::NodeHandle stream_pnh(pnh, names[i]);
+      streams.push_back(boost::make_shared<DepthImageToLaserScanROS>(stream_nh, stream_pnh, pool));
+    }
+  };
+  
+  boost::shared_ptr<WorkStealingPool> pool;
+  std::vector<boost::shared_ptr<DepthImageToLaserScanROS> > streams;
+};
+
+}
+
+#include <pluginlib/class_list_macros.h>
+PLUGINLIB_DECLARE_CLASS(depthimage_to_laserscan, DepthImageToLaserScanMultiNodelet, full_depthimage_to_laserscan::DepthImageToLaserScanMultiNodelet, nodelet::Nodelet);
@@ -32,68 +32,648 @@
  */
 
 #include <full_depthimage_to_laserscan/DepthImageToLaserScanROS.h>
+#include <image_transport/camera_common.h>
+#include <cstring>
 
 using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  const int SAFETY_UNSET = -2; ///< pending_safety_ of a frame whose conversion didn't check the zones
+}
   
-DepthImageToLaserScanROS::DepthImageToLaserScanROS(ros::NodeHandle& n, ros::NodeHandle& pnh):pnh_(pnh), it_(n), srv_(pnh) {
+DepthImageToLaserScanROS::DepthImageToLaserScanROS(ros::NodeHandle& n, ros::NodeHandle& pnh, 
+                                                   const boost::shared_ptr<WorkStealingPool>& pool):
+  nh_(n), pnh_(pnh), it_(n), pool_(pool), pool_stream_(-1), srv_(pnh) {
   boost::mutex::scoped_lock lock(connect_mutex_);
   
+  approach_ = DepthImageToLaserScan::KERNEL_AUTO;
+  reported_kernel_ = DepthImageToLaserScan::KERNEL_AUTO;
+  config_generation_ = 0;
+  pulled_generation_ = 0;
+  
   // Dynamic Reconfigure
   dynamic_reconfigure::Server<full_depthimage_to_laserscan::DepthConfig>::CallbackType f;
   f = boost::bind(&DepthImageToLaserScanROS::reconfigureCb, this, _1, _2);
   srv_.setCallback(f);
   
-  approach_=0;
-  pnh_.getParam("approach", approach_);
-  ROS_INFO_STREAM("Approach: " << approach_);
+  if(pool_)
+  {
+    double priority = 1.0;
+    pnh_.getParam("priority", priority);
+    pool_stream_ = pool_->add_stream(priority);
+    dtl_.set_parallel_executor(boost::bind(&WorkStealingPool::run_parallel, pool_.get(), _1), pool_->num_threads());
+  }
+  
+  // Stereo cameras can feed the disparity image directly instead of a depth image
+  use_disparity_ = false;
+  disparity_subscribed_ = false;
+  pnh_.getParam("use_disparity", use_disparity_);
+  disparity_sync_.reset(new DisparitySync(disparity_sub_, disparity_info_sub_, 10));
+  disparity_sync_->registerCallback(boost::bind(&DepthImageToLaserScanROS::disparityCb, this, _1, _2));
   
+  // Optionally, raw depth images are deserialized straight into pooled buffers, without clearing each frame's buffer
+  // first; other transports decode the image themselves and go through image_transport. Off by default: a PooledImage
+  // subscriber can't share the publisher's sensor_msgs::Image in a nodelet manager, so every frame would be serialized
+  // and deserialized instead of passed by pointer
+  std::string transport = "raw";
+  pnh_.getParam("image_transport", transport);
+  pooled_images_ = false;
+  pnh_.getParam("pooled_images", pooled_images_);
+  pooled_images_ = pooled_images_ && transport == "raw";
+  pooled_subscribed_ = false;
+  pooled_sync_.reset(new PooledSync(pooled_sub_, pooled_info_sub_, 10));
+  pooled_sync_->registerCallback(boost::bind(&DepthImageToLaserScanROS::pooledDepthCb, this, _1, _2));
+  
+  // Organized point clouds (e.g. from simulation) are converted directly, without a depth image
+  use_cloud_ = false;
+  pnh_.getParam("use_cloud", use_cloud_);
   
   // Lazy subscription to depth image topic
   pub_ = n.advertise<sensor_msgs::LaserScan>("scan", 10, boost::bind(&DepthImageToLaserScanROS::connectCb, this, _1), boost::bind(&DepthImageToLaserScanROS::disconnectCb, this, _1));
   
+  grid_pub_ = n.advertise<nav_msgs::OccupancyGrid>("scan_grid", 1, boost::bind(&DepthImageToLaserScanROS::connectCb, this, _1), boost::bind(&DepthImageToLaserScanROS::disconnectCb, this, _1));
+  
+  compact_pub_ = n.advertise<full_depthimage_to_laserscan::CompactScan>("compact_scan", 10, boost::bind(&DepthImageToLaserScanROS::connectCb, this, _1), boost::bind(&DepthImageToLaserScanROS::disconnectCb, this, _1));
+  
   im_pub_ = it_.advertise("mask_image", 1);
   
+  // Accepted pixels of the band, for debugging false positives; not a reason to subscribe to the input on its own
+  obstacle_mask_pub_ = it_.advertise("obstacle_mask", 1);
+  
+  safety_enabled_ = false;
+  safety_before_scan_ = true;
+  pnh_.getParam("safety_before_scan", safety_before_scan_);
+  pending_safety_ = SAFETY_UNSET;
+  loadSafetyZones();
+  
+  safety_stop_pub_ = n.advertise<std_msgs::Bool>("safety_stop", 1, boost::bind(&DepthImageToLaserScanROS::connectCb, this, _1), boost::bind(&DepthImageToLaserScanROS::disconnectCb, this, _1));
+  safety_zone_pub_ = n.advertise<std_msgs::Int8>("safety_zone", 1, boost::bind(&DepthImageToLaserScanROS::connectCb, this, _1), boost::bind(&DepthImageToLaserScanROS::disconnectCb, this, _1));
+  
+  quality_pub_ = n.advertise<std_msgs::UInt8>("scan_quality", 1, true);
+  std_msgs::UInt8 quality;
+  quality.data = scheduler_.level();
+  quality_pub_.publish(quality);
+  
+  // Data-quality counters; not a reason to subscribe to the input on its own
+  double diagnostics_period = 1.0, diagnostics_trend = 60.0;
+  pnh_.getParam("diagnostics_period", diagnostics_period);
+  pnh_.getParam("diagnostics_trend", diagnostics_trend);
+  diagnostics_.configure(pnh_.getNamespace(), diagnostics_period, diagnostics_trend);
+  diag_pub_ = n.advertise<diagnostic_msgs::DiagnosticArray>("diagnostics", 1);
+  
+  // Shared-memory output for consumers outside of ROS; they can't be counted, so it keeps the input subscribed
+  shm_slots_ = 4;
+  pnh_.getParam("shm_name", shm_name_);
+  pnh_.getParam("shm_slots", shm_slots_);
+  
+  // Pull mode: frames are only retained, and converted on request or at pull_rate
+  pull_mode_ = false;
+  pnh_.getParam("pull_mode", pull_mode_);
+  scan_srv_ = pnh_.advertiseService("get_scan", &DepthImageToLaserScanROS::getScanCb, this);
+  if(pull_mode_)
+  {
+    double pull_rate = 0;
+    pnh_.getParam("pull_rate", pull_rate);
+    if(pull_rate > 0)
+    {
+      pull_timer_ = n.createTimer(ros::Duration(1.0/pull_rate), &DepthImageToLaserScanROS::pullTimerCb, this);
+    }
+    ROS_INFO_STREAM("Pull mode: converting on request" << (pull_rate > 0 ? " and at pull_rate" : ""));
+  }
+  if(!shm_name_.empty())
+  {
+    ROS_INFO_STREAM("Writing scans to the shared-memory ring " << shm_name_);
+  }
+  subscribe();
 }
 
 DepthImageToLaserScanROS::~DepthImageToLaserScanROS(){
   sub_.shutdown();
 }
 
+namespace
+{
+  double toDouble(XmlRpc::XmlRpcValue& value)
+  {
+    if(value.getType() == XmlRpc::XmlRpcValue::TypeInt)
+    {
+      return (int)value;
+    }
+    return (double)value;
+  }
+}
+
+void DepthImageToLaserScanROS::loadSafetyZones(){
+  XmlRpc::XmlRpcValue zones_param;
+  if(!pnh_.getParam("safety_zones", zones_param))
+  {
+    return;
+  }
+  
+  std::vector<Polygon> zones;
+  try
+  {
+    if(zones_param.getType() != XmlRpc::XmlRpcValue::TypeArray)
+    {
+      throw std::runtime_error("safety_zones must be a list of polygons");
+    }
+    for(int i = 0; i < zones_param.size(); ++i)
+    {
+      XmlRpc::XmlRpcValue& zone_param = zones_param[i];
+      if(zone_param.getType() != XmlRpc::XmlRpcValue::TypeArray || zone_param.size() < 3)
+      {
+        throw std::runtime_error("each safety zone must be a list of at least 3 [x, y] points");
+      }
+      Polygon zone;
+      for(int j = 0; j < zone_param.size(); ++j)
+      {
+        XmlRpc::XmlRpcValue& point = zone_param[j];
+        if(point.getType() != XmlRpc::XmlRpcValue::TypeArray || point.size() != 2)
+        {
+          throw std::runtime_error("each point of a safety zone must be an [x, y] pair");
+        }
+        zone.push_back(cv::Point2d(toDouble(point[0]), toDouble(point[1])));
+      }
+      zones.push_back(zone);
+    }
+  }
+  catch (XmlRpc::XmlRpcException& e)
+  {
+    ROS_ERROR_STREAM("Invalid safety_zones parameter: " << e.getMessage());
+    return;
+  }
+  catch (std::runtime_error& e)
+  {
+    ROS_ERROR_STREAM("Invalid safety_zones parameter: " << e.what());
+    return;
+  }
+  
+  int min_columns = 3;
+  pnh_.getParam("safety_min_columns", min_columns);
+  
+  ROS_INFO_STREAM("Loaded " << zones.size() << " safety zones");
+  
+  boost::mutex::scoped_lock lock(config_mutex_);
+  dtl_.set_safety_zones(zones, min_columns);
+  dtl_.set_safety_callback(boost::bind(&DepthImageToLaserScanROS::safetyCb, this, _1));
+  safety_enabled_ = !zones.empty();
+}
+
+void DepthImageToLaserScanROS::safetyCb(int zone){
+  if(safety_before_scan_)
+  {
+    publishSafety(zone);
+  }
+  else
+  {
+    pending_safety_ = zone;
+  }
+}
+
+void DepthImageToLaserScanROS::publishSafety(int zone){
+  std_msgs::Bool stop;
+  stop.data = zone >= 0;
+  safety_stop_pub_.publish(stop);
+  
+  std_msgs::Int8 state;
+  state.data = zone;
+  safety_zone_pub_.publish(state);
+}
+
 
 
 void DepthImageToLaserScanROS::depthCb(const sensor_msgs::ImageConstPtr& depth_msg,
 	      const sensor_msgs::CameraInfoConstPtr& info_msg){
+  if(pull_mode_)
+  {
+    // Only keep a reference to the latest frame; it's converted when a scan is requested
+    boost::mutex::scoped_lock lock(frame_mutex_);
+    latest_depth_ = depth_msg;
+    latest_info_ = info_msg;
+    return;
+  }
+  
+  auto convert = [this, depth_msg, info_msg]() {
+    processFrame([&](sensor_msgs::ImageConstPtr& image) {
+      return dtl_.convert_msg(depth_msg, info_msg, approach_, image);
+    }, depth_msg->header.stamp);
+  };
+  
+  if(pool_)
+  {
+    // Replaces this stream's previous frame if the pool hasn't got to it yet
+    pool_->submit(pool_stream_, convert);
+    return;
+  }
+  
+  convert();
+}
+
+void DepthImageToLaserScanROS::pooledDepthCb(const PooledImageConstPtr& depth_msg,
+                                             const sensor_msgs::CameraInfoConstPtr& info_msg){
+  if(pull_mode_)
+  {
+    boost::mutex::scoped_lock lock(frame_mutex_);
+    latest_pooled_ = depth_msg;
+    latest_info_ = info_msg;
+    return;
+  }
+  
+  auto convert = [this, depth_msg, info_msg]() {
+    processFrame([&](sensor_msgs::ImageConstPtr& image) {
+      return dtl_.convert_buffer(pooled_image_geometry(*depth_msg), depth_msg->data.data(), info_msg, approach_, image, 
+                                 depth_msg);
+    }, depth_msg->header.stamp);
+  };
+  
+  if(pool_)
+  {
+    pool_->submit(pool_stream_, convert);
+    return;
+  }
+  
+  convert();
+}
+
+void DepthImageToLaserScanROS::disparityCb(const stereo_msgs::DisparityImageConstPtr& disparity_msg,
+                                           const sensor_msgs::CameraInfoConstPtr& info_msg){
+  if(pull_mode_)
+  {
+    boost::mutex::scoped_lock lock(frame_mutex_);
+    latest_disparity_ = disparity_msg;
+    latest_info_ = info_msg;
+    return;
+  }
+  
+  auto convert = [this, disparity_msg, info_msg]() {
+    processFrame([&](sensor_msgs::ImageConstPtr& image) {
+      return dtl_.convert_disparity(disparity_msg, info_msg);
+    }, disparity_msg->header.stamp);
+  };
+  
+  if(pool_)
+  {
+    pool_->submit(pool_stream_, convert);
+    return;
+  }
+  
+  convert();
+}
+
+void DepthImageToLaserScanROS::cloudCb(const sensor_msgs::PointCloud2ConstPtr& cloud_msg){
+  sensor_msgs::CameraInfoConstPtr info_msg;
+  {
+    boost::mutex::scoped_lock lock(frame_mutex_);
+    info_msg = cloud_info_;
+    if(pull_mode_)
+    {
+      latest_cloud_ = cloud_msg;
+      latest_info_ = info_msg;
+      return;
+    }
+  }
+  
+  auto convert = [this, cloud_msg, info_msg]() {
+    processFrame([&](sensor_msgs::ImageConstPtr& image) {
+      return dtl_.convert_cloud(cloud_msg, info_msg);
+    }, cloud_msg->header.stamp);
+  };
+  
+  if(pool_)
+  {
+    pool_->submit(pool_stream_, convert);
+    return;
+  }
+  
+  convert();
+}
+
+void DepthImageToLaserScanROS::cloudInfoCb(const sensor_msgs::CameraInfoConstPtr& info_msg){
+  boost::mutex::scoped_lock lock(frame_mutex_);
+  cloud_info_ = info_msg;
+}
+
+sensor_msgs::LaserScanConstPtr DepthImageToLaserScanROS::pullScan(){
+  boost::mutex::scoped_lock pull_lock(pull_mutex_);
+  
+  // Read before converting, so that a reconfiguration during the conversion makes the next request convert again
+  const unsigned int generation = config_generation_;
+  
+  sensor_msgs::ImageConstPtr depth_msg;
+  PooledImageConstPtr pooled_msg;
+  stereo_msgs::DisparityImageConstPtr disparity_msg;
+  sensor_msgs::PointCloud2ConstPtr cloud_msg;
+  sensor_msgs::CameraInfoConstPtr info_msg;
+  {
+    boost::mutex::scoped_lock lock(frame_mutex_);
+    depth_msg = latest_depth_;
+    pooled_msg = latest_pooled_;
+    disparity_msg = latest_disparity_;
+    cloud_msg = latest_cloud_;
+    info_msg = latest_info_;
+  }
+  
+  boost::shared_ptr<const void> frame;
+  if(depth_msg)
+  {
+    frame = depth_msg;
+  }
+  else if(pooled_msg)
+  {
+    frame = pooled_msg;
+  }
+  else if(disparity_msg)
+  {
+    frame = disparity_msg;
+  }
+  else
+  {
+    frame = cloud_msg;
+  }
+  if(!frame || (frame == pulled_frame_ && generation == pulled_generation_))
+  {
+    return pulled_scan_; // Nothing received yet, or the scan of this frame is still current
+  }
+  
+  sensor_msgs::LaserScanPtr scan_msg;
+  auto convert = [&]() {
+    if(depth_msg)
+    {
+      scan_msg = processFrame([&](sensor_msgs::ImageConstPtr& image) {
+        return dtl_.convert_msg(depth_msg, info_msg, approach_, image);
+      }, depth_msg->header.stamp, false);
+    }
+    else if(pooled_msg)
+    {
+      scan_msg = processFrame([&](sensor_msgs::ImageConstPtr& image) {
+        return dtl_.convert_buffer(pooled_image_geometry(*pooled_msg), pooled_msg->data.data(), info_msg, approach_, 
+                                   image, pooled_msg);
+      }, pooled_msg->header.stamp, false);
+    }
+    else if(disparity_msg)
+    {
+      scan_msg = processFrame([&](sensor_msgs::ImageConstPtr& image) {
+        return dtl_.convert_disparity(disparity_msg, info_msg);
+      }, disparity_msg->header.stamp, false);
+    }
+    else
+    {
+      scan_msg = processFrame([&](sensor_msgs::ImageConstPtr& image) {
+        return dtl_.convert_cloud(cloud_msg, info_msg);
+      }, cloud_msg->header.stamp, false);
+    }
+  };
+  
+  // With a shared pool, a requested frame is converted as a frame of this stream, so it is scheduled against the
+  // other streams and can fork the threaded kernel onto the workers; the frame callbacks don't submit in pull mode
+  if(pool_)
+  {
+    pool_->run(pool_stream_, convert);
+  }
+  else
+  {
+    convert();
+  }
+  
+  if(scan_msg)
+  {
+    pulled_frame_ = frame;
+    pulled_generation_ = generation;
+    pulled_scan_ = scan_msg;
+  }
+  return scan_msg;
+}
+
+bool DepthImageToLaserScanROS::getScanCb(full_depthimage_to_laserscan::GetScan::Request& req, 
+                                         full_depthimage_to_laserscan::GetScan::Response& res){
+  sensor_msgs::LaserScanConstPtr scan_msg = pullScan();
+  if(!scan_msg)
+  {
+    res.success = false;
+    res.message = pull_mode_ ? "No frame has been converted yet" : "The scan service is only available in pull mode";
+    return true;
+  }
+  res.success = true;
+  res.scan = *scan_msg;
+  return true;
+}
+
+void DepthImageToLaserScanROS::pullTimerCb(const ros::TimerEvent& event){
+  if(hasSubscribers())
+  {
+    pullScan();
+  }
+}
+
+sensor_msgs::LaserScanPtr DepthImageToLaserScanROS::processFrame(const ConvertFunction& convert, const ros::Time& stamp, 
+                                                                 const bool allow_skip){
   try
   {
     ros::WallTime start = ros::WallTime::now();
     
     sensor_msgs::ImageConstPtr image;
     sensor_msgs::LaserScanPtr scan_msg;
+    nav_msgs::OccupancyGridPtr grid_msg;
+    full_depthimage_to_laserscan::CompactScanPtr compact_msg;
+    diagnostic_msgs::DiagnosticArrayPtr diag_msg;
+    sensor_msgs::ImagePtr obstacle_mask;
+    int safety = SAFETY_UNSET;
     
     {
       boost::mutex::scoped_lock lock(config_mutex_);
-      scan_msg= dtl_.convert_msg(depth_msg, info_msg, approach_, image);
+      if(allow_skip && scheduler_.skip_frame()) // Frames converted on request don't count towards skipping
+      {
+        return sensor_msgs::LaserScanPtr();
+      }
+      dtl_.set_row_stride(scheduler_.row_stride());
+      const bool diagnostics = diag_pub_.getNumSubscribers()>0;
+      dtl_.set_collect_stats(diagnostics);
+      const bool mask = obstacle_mask_pub_.getNumSubscribers()>0;
+      dtl_.set_collect_mask(mask);
+      pending_safety_ = SAFETY_UNSET;
+      scan_msg = convert(image);
+      safety = pending_safety_;
+      
+      if(mask)
+      {
+        obstacle_mask = boost::make_shared<sensor_msgs::Image>();
+        if(!dtl_.get_obstacle_mask(*obstacle_mask))
+        {
+          obstacle_mask.reset(); // A mode that doesn't record the mask
+        }
+      }
+      
+      ConversionStats stats;
+      if(dtl_.get_stats(stats))
+      {
+        diagnostics_.add(stats);
+      }
+      diagnostic_msgs::DiagnosticStatus status;
+      if(diagnostics && diagnostics_.report(ros::Time::now(), status))
+      {
+        diag_msg = boost::make_shared<diagnostic_msgs::DiagnosticArray>();
+        diag_msg->header.stamp = stamp;
+        diag_msg->status.push_back(status);
+      }
+      
+      if(grid_pub_.getNumSubscribers()>0 && dtl_.grid_enabled())
+      {
+        grid_msg = boost::make_shared<nav_msgs::OccupancyGrid>();
+        dtl_.convert_grid(*scan_msg, *grid_msg);
+      }
+      
+      if(compact_pub_.getNumSubscribers()>0)
+      {
+        std::vector<uint16_t> ranges_mm;
+        dtl_.compact_ranges(*scan_msg, ranges_mm);
+        compact_msg = boost::make_shared<full_depthimage_to_laserscan::CompactScan>();
+        if(!compact_encoder_.encode(*scan_msg, ranges_mm, *compact_msg))
+        {
+          compact_msg.reset(); // Nothing changed
+        }
+      }
+      
+      if(!shm_name_.empty())
+      {
+        writeShm(*scan_msg);
+      }
     }
     
-    ROS_INFO_STREAM("Approach: " << approach_ << "Conversion time: " << (ros::WallTime::now() - start).toSec() * 1e3 << "ms");
+    double latency = (ros::WallTime::now() - start).toSec();
+    ROS_DEBUG_STREAM("Conversion time: " << latency * 1e3 << "ms");
     pub_.publish(scan_msg);
     
-    if(im_pub_.getNumSubscribers()>0)
+    if(safety_enabled_ && !safety_before_scan_ && safety != SAFETY_UNSET)
+    {
+      publishSafety(safety);
+    }
+    
+    {
+      boost::mutex::scoped_lock lock(config_mutex_);
+      if(scheduler_.update(latency))
+      {
+        ROS_INFO_STREAM("Conversion quality level: " << scheduler_.level() << " (row stride " << scheduler_.row_stride() << ")");
+        std_msgs::UInt8 quality;
+        quality.data = scheduler_.level();
+        quality_pub_.publish(quality);
+      }
+    }
+    
+    reportKernel();
+    
+    if(grid_msg)
+    {
+      grid_pub_.publish(grid_msg);
+    }
+    
+    if(compact_msg)
+    {
+      compact_pub_.publish(compact_msg);
+    }
+    
+    if(diag_msg)
+    {
+      diag_pub_.publish(diag_msg);
+    }
+    
+    if(im_pub_.getNumSubscribers()>0 && image)
     {
       sensor_msgs::ImagePtr new_mask = boost::make_shared<sensor_msgs::Image>(*image);
-      new_mask->header.stamp = depth_msg->header.stamp;
+      new_mask->header.stamp = stamp;
       im_pub_.publish(new_mask);
     }
+    
+    if(obstacle_mask)
+    {
+      obstacle_mask_pub_.publish(obstacle_mask);
+    }
+    
+    return scan_msg;
   }
   catch (std::runtime_error& e)
   {
     ROS_ERROR_THROTTLE(1.0, "Could not convert depth image to laserscan: %s", e.what());
   }
+  return sensor_msgs::LaserScanPtr();
+}
+
+void DepthImageToLaserScanROS::writeShm(const sensor_msgs::LaserScan& scan_msg){
+  // Called with config_mutex_ held, so there is a single writer per converter
+  try
+  {
+    if(!shm_writer_.is_open() || shm_writer_.max_beams() < scan_msg.ranges.size())
+    {
+      shm_writer_.open(shm_name_, shm_slots_, scan_msg.ranges.size());
+    }
+  }
+  catch (std::runtime_error& e)
+  {
+    ROS_ERROR_THROTTLE(10.0, "Could not open the shared-memory ring: %s", e.what());
+    return;
+  }
+  
+  ShmScanInfo info;
+  info.stamp = scan_msg.header.stamp.toNSec();
+  info.seq = scan_msg.header.seq;
+  strncpy(info.frame_id, scan_msg.header.frame_id.c_str(), sizeof(info.frame_id) - 1);
+  info.frame_id[sizeof(info.frame_id) - 1] = '\0';
+  info.angle_min = scan_msg.angle_min;
+  info.angle_max = scan_msg.angle_max;
+  info.angle_increment = scan_msg.angle_increment;
+  info.time_increment = scan_msg.time_increment;
+  info.scan_time = scan_msg.scan_time;
+  info.range_min = scan_msg.range_min;
+  info.range_max = scan_msg.range_max;
+  shm_writer_.write(info, scan_msg.ranges.data(), scan_msg.ranges.size());
+}
+
+void DepthImageToLaserScanROS::reportKernel(){
+  DepthConfig config;
+  {
+    boost::mutex::scoped_lock lock(config_mutex_);
+    int kernel = (approach_ == DepthImageToLaserScan::KERNEL_AUTO) ? dtl_.tuned_kernel() : approach_;
+    if(kernel == reported_kernel_)
+    {
+      return;
+    }
+    reported_kernel_ = kernel;
+    config_.selected_kernel = DepthImageToLaserScan::kernel_name(kernel);
+    config = config_;
+  }
+  ROS_INFO_STREAM("Conversion kernel: " << config.selected_kernel);
+  srv_.updateConfig(config); // Outside of config_mutex_, as the server holds its own lock while calling reconfigureCb
 }
 
 void DepthImageToLaserScanROS::connectCb(const ros::SingleSubscriberPublisher& pub) {
   boost::mutex::scoped_lock lock(connect_mutex_);
-  if (!sub_ && pub_.getNumSubscribers() > 0) {
+  subscribe();
+}
+
+void DepthImageToLaserScanROS::subscribe() {
+  if (!hasSubscribers() && !pull_mode_) {
+    return;
+  }
+  if (use_cloud_ && !cloud_sub_) {
+    ROS_DEBUG("Connecting to point cloud topic.");
+    cloud_sub_ = nh_.subscribe("points", 10, &DepthImageToLaserScanROS::cloudCb, this);
+    cloud_info_sub_ = nh_.subscribe("camera_info", 1, &DepthImageToLaserScanROS::cloudInfoCb, this);
+  }
+  else if (use_disparity_ && !use_cloud_ && !disparity_subscribed_) {
+    ROS_DEBUG("Connecting to disparity topic.");
+    disparity_sub_.subscribe(nh_, "disparity", 10);
+    disparity_info_sub_.subscribe(nh_, "camera_info", 10);
+    disparity_subscribed_ = true;
+  }
+  else if (!use_disparity_ && !use_cloud_ && pooled_images_ && !pooled_subscribed_) {
+    ROS_DEBUG("Connecting to depth topic with pooled buffers.");
+    // The same topics image_transport's camera subscriber would use
+    const std::string topic = nh_.resolveName("image");
+    pooled_sub_.subscribe(nh_, topic, 10);
+    pooled_info_sub_.subscribe(nh_, image_transport::getCameraInfoTopic(topic), 10);
+    pooled_subscribed_ = true;
+  }
+  else if (!use_disparity_ && !use_cloud_ && !pooled_images_ && !sub_) {
     ROS_DEBUG("Connecting to depth topic.");
     image_transport::TransportHints hints("raw", ros::TransportHints(), pnh_);
     sub_ = it_.subscribeCamera("image", 10, &DepthImageToLaserScanROS::depthCb, this, hints);
@@ -102,20 +682,60 @@ void DepthImageToLaserScanROS::connectCb(const ros::SingleSubscriberPublisher& p
 
 void DepthImageToLaserScanROS::disconnectCb(const ros::SingleSubscriberPublisher& pub) {
   boost::mutex::scoped_lock lock(connect_mutex_);
-  if (pub_.getNumSubscribers() == 0) {
+  if (!hasSubscribers() && !pull_mode_) { // In pull mode the latest frame must always be available
     ROS_DEBUG("Unsubscribing from depth topic.");
     sub_.shutdown();
+    disparity_sub_.unsubscribe();
+    disparity_info_sub_.unsubscribe();
+    disparity_subscribed_ = false;
+    cloud_sub_.shutdown();
+    cloud_info_sub_.shutdown();
+    pooled_sub_.unsubscribe();
+    pooled_info_sub_.unsubscribe();
+    pooled_subscribed_ = false;
   }
 }
 
+bool DepthImageToLaserScanROS::hasSubscribers() const {
+  return pub_.getNumSubscribers() > 0 || grid_pub_.getNumSubscribers() > 0 || compact_pub_.getNumSubscribers() > 0 || 
+    safety_stop_pub_.getNumSubscribers() > 0 || safety_zone_pub_.getNumSubscribers() > 0 || !shm_name_.empty();
+}
+
 void DepthImageToLaserScanROS::reconfigureCb(full_depthimage_to_laserscan::DepthConfig& config, uint32_t level){
   boost::mutex::scoped_lock lock(config_mutex_);
   
+  // The cached scan was converted with the old configuration. pull_mutex_ can't be taken here: pullScan holds it
+  // while reportKernel waits for the server lock, which is held during this callback
+  ++config_generation_;
+  
     dtl_.set_scan_time(config.scan_time);
     dtl_.set_range_limits(config.range_min, config.range_max);
     dtl_.set_scan_height(config.scan_height);
     dtl_.set_output_frame(config.output_frame_id);
     dtl_.set_filtering_limits(config.floor_dist, config.overhead_dist);
+    dtl_.set_camera_tilt(config.camera_tilt);
+    dtl_.set_floor_estimation(config.estimate_floor, config.floor_estimation_rate, config.floor_margin);
+    dtl_.set_speckle_filter(config.min_support, config.support_tolerance);
+    dtl_.set_undistort(config.undistort);
+    dtl_.set_rotation(config.rotation);
+    dtl_.set_incremental(config.incremental, config.incremental_tolerance, config.incremental_refresh);
+    dtl_.set_quantize(config.quantize);
+    dtl_.set_grid_geometry(config.grid_resolution, config.grid_size);
+    compact_encoder_.configure(config.compact_delta, config.compact_keyframe_interval, config.compact_tolerance);
+    const int quality_level = scheduler_.level();
+    scheduler_.set_budget(config.time_budget);
+    if(scheduler_.level() != quality_level && quality_pub_) // Not advertised yet during construction
+    {
+      std_msgs::UInt8 quality;
+      quality.data = scheduler_.level();
+      quality_pub_.publish(quality);
+    }
+    approach_ = config.approach;
+    dtl_.set_profiling(config.profile);
+    
+    // selected_kernel is read only
+    config.selected_kernel = DepthImageToLaserScan::kernel_name(reported_kernel_);
+    config_ = config;
     
     dtl_.updateCache();
 }
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/FloorEstimator.h>
+#include <full_depthimage_to_laserscan/depth_traits.h>
+#include <full_depthimage_to_laserscan/image_rotation.h>
+#include <sensor_msgs/image_encodings.h>
+#include <boost/bind/bind.hpp>
+#include <cmath>
+#include <limits>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  const int MAX_SAMPLES = 2000; ///< Approximate number of pixels sampled from a frame
+  const int MIN_POINTS = 50; ///< Minimum number of inliers of an accepted plane
+  const double MIN_INLIER_FRACTION = 0.3; ///< Minimum fraction of the sampled points that must support the plane
+  const int ITERATIONS = 100; ///< RANSAC hypotheses per frame
+  const float MIN_DEPTH = 0.2f, MAX_DEPTH = 6.0f; ///< Depths (in meters) of usable points
+  const float SEARCH_DISTANCE = 0.15f; ///< Only points within this distance (in meters) of the prior plane are sampled
+  const float INLIER_DISTANCE = 0.02f; ///< Distance (in meters) within which a point supports a plane
+  const float MAX_DEVIATION = 0.1f; ///< Largest change of tilt and roll (in radians) from the prior
+  const float SMOOTHING = 0.3f; ///< Weight of a new fit in the smoothed estimate
+  const float HEIGHT_DEADBAND = 0.003f, TILT_DEADBAND = 0.002f; ///< Smallest changes reported by poll
+
+  /**
+   * Solves m * x = r for a 3x3 system by Cramer's rule.
+   */
+  bool solve3(const double m[3][3], const double r[3], double x[3])
+  {
+    double det = m[0][0]*(m[1][1]*m[2][2] - m[1][2]*m[2][1])
+               - m[0][1]*(m[1][0]*m[2][2] - m[1][2]*m[2][0])
+               + m[0][2]*(m[1][0]*m[2][1] - m[1][1]*m[2][0]);
+    if(std::abs(det) < 1e-12)
+    {
+      return false;
+    }
+    for(int k = 0; k < 3; ++k)
+    {
+      double c[3][3];
+      for(int i = 0; i < 3; ++i)
+      {
+        for(int j = 0; j < 3; ++j)
+        {
+          c[i][j] = (j == k) ? r[i] : m[i][j];
+        }
+      }
+      x[k] = (c[0][0]*(c[1][1]*c[2][2] - c[1][2]*c[2][1])
+            - c[0][1]*(c[1][0]*c[2][2] - c[1][2]*c[2][0])
+            + c[0][2]*(c[1][0]*c[2][1] - c[1][1]*c[2][0])) / det;
+    }
+    return true;
+  }
+
+  /**
+   * Floor plane in camera coordinates, y = a*x + b*z + c (y points down, z along the optical axis).
+   *
+   * The plane's downward normal is (-a, 1, -b)/norm, so the roll is atan(a), the downward tilt is atan(-b) and the
+   * height is c/norm.
+   */
+  struct PlaneModel
+  {
+    double a, b, c;
+
+    double norm() const
+    {
+      return std::sqrt(a*a + 1 + b*b);
+    }
+
+    double distance(const float* p) const
+    {
+      return std::abs(p[1] - a*p[0] - b*p[2] - c) / norm();
+    }
+  };
+}
+
+FloorEstimator::FloorEstimator():
+  enabled_(false), stopped_(false), busy_(false), period_(0.5), frame_pixels_(NULL), changed_(false), seed_(1)
+{
+  initial_.height = initial_.tilt = std::numeric_limits<float>::quiet_NaN();
+}
+
+FloorEstimator::~FloorEstimator()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stopped_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+}
+
+void FloorEstimator::configure(const bool enabled, const double rate)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  enabled_ = enabled;
+  period_ = 1.0 / std::max(rate, 0.01);
+  if(!enabled_)
+  {
+    frame_.reset();
+    frame_owner_.reset();
+    initial_.height = initial_.tilt = std::numeric_limits<float>::quiet_NaN(); // Restart from the configuration
+    changed_ = false;
+  }
+  else if(thread_.get_id() == boost::thread::id())
+  {
+    thread_ = boost::thread(boost::bind(&FloorEstimator::work, this));
+  }
+}
+
+void FloorEstimator::offer(const sensor_msgs::ImageConstPtr& depth_msg, const uint8_t* pixels,
+                           const boost::shared_ptr<const void>& owner, const image_geometry::PinholeCameraModel& cam_model,
+                           const Plane& initial, const int rotation)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if(!enabled_)
+  {
+    return;
+  }
+
+  if(initial.height != initial_.height || initial.tilt != initial_.tilt)
+  {
+    // The configured plane changed; fits of older frames must not be applied to the new estimate
+    initial_ = initial;
+    plane_ = reported_ = initial;
+    changed_ = false;
+    frame_.reset();
+    frame_owner_.reset();
+    next_ = ros::WallTime();
+  }
+
+  ros::WallTime now = ros::WallTime::now();
+  if(busy_ || frame_ || now < next_)
+  {
+    return;
+  }
+  next_ = now + ros::WallDuration(period_);
+
+  frame_ = depth_msg;
+  frame_pixels_ = pixels;
+  frame_owner_ = owner;
+  intrinsics_.fx = cam_model.fx();
+  intrinsics_.fy = cam_model.fy();
+  intrinsics_.cx = cam_model.cx();
+  intrinsics_.cy = cam_model.cy();
+  intrinsics_.rotation = rotation;
+  wake_.notify_one();
+}
+
+bool FloorEstimator::poll(Plane& plane)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if(!enabled_ || !changed_)
+  {
+    return false;
+  }
+  plane = reported_ = plane_;
+  changed_ = false;
+  return true;
+}
+
+void FloorEstimator::work()
+{
+  while(true)
+  {
+    sensor_msgs::ImageConstPtr frame;
+    const uint8_t* pixels;
+    boost::shared_ptr<const void> owner;
+    Intrinsics intrinsics;
+    Plane prior, initial;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while(!stopped_ && !frame_)
+      {
+        wake_.wait(lock);
+      }
+      if(stopped_)
+      {
+        return;
+      }
+      frame.swap(frame_);
+      pixels = frame_pixels_;
+      owner.swap(frame_owner_);
+      intrinsics = intrinsics_;
+      prior = plane_;
+      initial = initial_;
+      busy_ = true;
+    }
+
+    Plane fitted;
+    bool ok = fit(*frame, pixels, intrinsics, prior, fitted);
+    frame.reset(); // Don't hold on to the image while idle
+    owner.reset();
+
+    boost::mutex::scoped_lock lock(mutex_);
+    busy_ = false;
+    if(!ok)
+    {
+      ROS_DEBUG("Floor plane estimation: no plane found near the current estimate");
+      continue;
+    }
+    if(initial.height != initial_.height || initial.tilt != initial_.tilt)
+    {
+      continue; // Reconfigured while fitting
+    }
+
+    plane_.height += SMOOTHING * (fitted.height - plane_.height);
+    plane_.tilt += SMOOTHING * (fitted.tilt - plane_.tilt);
+    changed_ = std::abs(plane_.height - reported_.height) > HEIGHT_DEADBAND ||
+               std::abs(plane_.tilt - reported_.tilt) > TILT_DEADBAND;
+    ROS_DEBUG_STREAM("Floor plane fit: height " << fitted.height << " m, tilt " << fitted.tilt << " rad; estimate " <<
+                     plane_.height << " m, " << plane_.tilt << " rad");
+  }
+}
+
+template<typename T>
+void FloorEstimator::sample_points(const sensor_msgs::Image& depth_msg, const uint8_t* pixels, const Intrinsics& intrinsics,
+                                   const Plane& prior)
+{
+  const RotatedView<T> image = rotated_view<T>(depth_msg, pixels, intrinsics.rotation);
+  const int width = image.width, height = image.height;
+  const int stride = std::max(1, (int)std::sqrt((double)width*height / MAX_SAMPLES));
+
+  PlaneModel model = {0, -std::tan(prior.tilt), prior.height / std::cos(prior.tilt)};
+
+  points_.clear();
+  for(int v = stride/2; v < height; v += stride)
+  {
+    const float y_ratio = (v - intrinsics.cy) / intrinsics.fy;
+    for(int u = stride/2; u < width; u += stride)
+    {
+      T depth = image(u, v);
+      if(!DepthTraits<T>::valid(depth))
+      {
+        continue;
+      }
+      float z = DepthTraits<T>::toMeters(depth);
+      if(!(z > MIN_DEPTH && z < MAX_DEPTH))
+      {
+        continue;
+      }
+      float p[3] = {(float)((u - intrinsics.cx) / intrinsics.fx) * z, y_ratio * z, z};
+      if(model.distance(p) < SEARCH_DISTANCE)
+      {
+        points_.insert(points_.end(), p, p + 3);
+      }
+    }
+  }
+}
+
+bool FloorEstimator::fit(const sensor_msgs::Image& depth_msg, const uint8_t* pixels, const Intrinsics& intrinsics,
+                         const Plane& prior, Plane& plane)
+{
+  if(depth_msg.encoding == sensor_msgs::image_encodings::TYPE_16UC1)
+  {
+    sample_points<uint16_t>(depth_msg, pixels, intrinsics, prior);
+  }
+  else if(depth_msg.encoding == sensor_msgs::image_encodings::TYPE_32FC1)
+  {
+    sample_points<float>(depth_msg, pixels, intrinsics, prior);
+  }
+  else
+  {
+    return false;
+  }
+
+  const int num_points = points_.size() / 3;
+  if(num_points < MIN_POINTS)
+  {
+    return false;
+  }
+
+  // RANSAC over planes through 3 sampled points
+  PlaneModel best = {0, 0, 0};
+  int best_inliers = 0;
+  for(int k = 0; k < ITERATIONS; ++k)
+  {
+    double m[3][3], r[3];
+    for(int i = 0; i < 3; ++i)
+    {
+      seed_ = seed_ * 1664525u + 1013904223u;
+      const float* p = &points_[3 * ((seed_ >> 8) % num_points)];
+      m[i][0] = p[0];
+      m[i][1] = p[2];
+      m[i][2] = 1;
+      r[i] = p[1];
+    }
+    double x[3];
+    if(!solve3(m, r, x))
+    {
+      continue;
+    }
+    PlaneModel model = {x[0], x[1], x[2]};
+    if(model.c <= 0 || std::abs(std::atan(model.a)) > MAX_DEVIATION ||
+       std::abs(std::atan(-model.b) - prior.tilt) > MAX_DEVIATION)
+    {
+      continue;
+    }
+
+    int inliers = 0;
+    for(int i = 0; i < num_points; ++i)
+    {
+      inliers += model.distance(&points_[3*i]) < INLIER_DISTANCE;
+    }
+    if(inliers > best_inliers)
+    {
+      best_inliers = inliers;
+      best = model;
+    }
+  }
+
+  if(best_inliers < std::max(MIN_POINTS, (int)(MIN_INLIER_FRACTION * num_points)))
+  {
+    return false;
+  }
+
+  // Least-squares refinement of y = a*x + b*z + c on the inliers
+  double m[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}}, r[3] = {0, 0, 0};
+  for(int i = 0; i < num_points; ++i)
+  {
+    const float* p = &points_[3*i];
+    if(best.distance(p) >= INLIER_DISTANCE)
+    {
+      continue;
+    }
+    const double q[3] = {p[0], p[2], 1};
+    for(int j = 0; j < 3; ++j)
+    {
+      for(int l = 0; l < 3; ++l)
+      {
+        m[j][l] += q[j] * q[l];
+      }
+      r[j] += q[j] * p[1];
+    }
+  }
+  double x[3];
+  if(!solve3(m, r, x))
+  {
+    return false;
+  }
+  PlaneModel refined = {x[0], x[1], x[2]};
+
+  plane.height = refined.c / refined.norm();
+  plane.tilt = std::atan(-refined.b);
+  return plane.height > 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/GeometryRegistry.h>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  template<typename T>
+  void append_bytes(std::string& key, const T& value)
+  {
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  void append_string(std::string& key, const std::string& value)
+  {
+    append_bytes(key, (uint32_t)value.size());
+    key.append(value);
+  }
+
+  template<typename Tables>
+  void prune(std::map<std::string, boost::weak_ptr<const Tables> >& entries)
+  {
+    for(typename std::map<std::string, boost::weak_ptr<const Tables> >::iterator it = entries.begin(); it != entries.end();)
+    {
+      if(it->second.expired())
+      {
+        entries.erase(it++);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+}
+
+GeometryRegistry& GeometryRegistry::instance()
+{
+  static GeometryRegistry registry;
+  return registry;
+}
+
+template<typename Tables>
+boost::shared_ptr<const Tables> GeometryRegistry::lookup(std::map<std::string, boost::weak_ptr<const Tables> >& entries,
+                                                         const std::string& key,
+                                                         const boost::function<boost::shared_ptr<Tables> ()>& build)
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    typename std::map<std::string, boost::weak_ptr<const Tables> >::iterator it = entries.find(key);
+    if(it != entries.end())
+    {
+      boost::shared_ptr<const Tables> tables = it->second.lock();
+      if(tables)
+      {
+        return tables;
+      }
+    }
+  }
+
+  // Building takes a while, so other cameras aren't held up; if two converters race, the first one registered wins
+  boost::shared_ptr<const Tables> built = build();
+
+  boost::mutex::scoped_lock lock(mutex_);
+  prune(entries);
+  boost::weak_ptr<const Tables>& entry = entries[key];
+  boost::shared_ptr<const Tables> tables = entry.lock();
+  if(!tables)
+  {
+    entry = built;
+    tables = built;
+  }
+  return tables;
+}
+
+GeometryRegistry::GeometryTablesConstPtr GeometryRegistry::geometry(const std::string& key,
+    const boost::function<boost::shared_ptr<GeometryTables> ()>& build)
+{
+  return lookup(geometry_, key, build);
+}
+
+GeometryRegistry::LimitTablesConstPtr GeometryRegistry::limits(const std::string& key,
+    const boost::function<boost::shared_ptr<LimitTables> ()>& build)
+{
+  return lookup(limits_, key, build);
+}
+
+size_t GeometryRegistry::size()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  prune(geometry_);
+  prune(limits_);
+  return geometry_.size() + limits_.size();
+}
+
+std::string GeometryRegistry::calibration_key(const sensor_msgs::CameraInfo& info, const sensor_msgs::Image& image)
+{
+  // Everything the camera model and the tables depend on, except the headers
+  std::string key;
+  append_string(key, image.encoding);
+  append_bytes(key, image.width);
+  append_bytes(key, image.height);
+  append_bytes(key, image.step);
+  append_bytes(key, info.width);
+  append_bytes(key, info.height);
+  append_string(key, info.distortion_model);
+  append_bytes(key, (uint32_t)info.D.size());
+  for(size_t i = 0; i < info.D.size(); ++i)
+  {
+    append_bytes(key, info.D[i]);
+  }
+  for(size_t i = 0; i < info.K.size(); ++i)
+  {
+    append_bytes(key, info.K[i]);
+  }
+  for(size_t i = 0; i < info.R.size(); ++i)
+  {
+    append_bytes(key, info.R[i]);
+  }
+  for(size_t i = 0; i < info.P.size(); ++i)
+  {
+    append_bytes(key, info.P[i]);
+  }
+  append_bytes(key, info.binning_x);
+  append_bytes(key, info.binning_y);
+  append_bytes(key, info.roi.x_offset);
+  append_bytes(key, info.roi.y_offset);
+  append_bytes(key, info.roi.width);
+  append_bytes(key, info.roi.height);
+  append_bytes(key, (uint8_t)info.roi.do_rectify);
+  return key;
+}
+
+void GeometryRegistry::append_key(std::string& key, const float value)
+{
+  append_bytes(key, value);
+}
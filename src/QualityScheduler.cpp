@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/QualityScheduler.h>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  // Row stride and frame divisor of each quality level; each step roughly halves the cost of a frame
+  const int ROW_STRIDES[QualityScheduler::NUM_LEVELS] = {1, 2, 4, 4, 8};
+  const int FRAME_DIVISORS[QualityScheduler::NUM_LEVELS] = {1, 1, 1, 2, 3};
+  
+  const double SMOOTHING = 0.2; ///< Weight of the newest sample in the smoothed conversion time
+  const double RECOVER_FRACTION = 0.4; ///< Quality is raised once the smoothed time is below this fraction of the budget
+  const int SETTLE_FRAMES = 10; ///< Frames to wait after a level change
+}
+
+QualityScheduler::QualityScheduler():
+  budget_(0), average_(0), level_(0), settle_(0), frame_(0)
+{
+}
+
+void QualityScheduler::set_budget(const double budget)
+{
+  budget_ = budget;
+  if(budget_ <= 0)
+  {
+    set_level(0);
+  }
+}
+
+bool QualityScheduler::skip_frame()
+{
+  frame_++;
+  return (frame_ % FRAME_DIVISORS[level_]) != 0;
+}
+
+bool QualityScheduler::update(const double latency)
+{
+  if(budget_ <= 0)
+  {
+    return false;
+  }
+  
+  average_ = (settle_ == SETTLE_FRAMES) ? latency : average_ + SMOOTHING * (latency - average_);
+  
+  if(settle_ > 0)
+  {
+    settle_--;
+    return false;
+  }
+  
+  int level = level_;
+  if(average_ > budget_ && level_ < NUM_LEVELS - 1)
+  {
+    set_level(level_ + 1);
+  }
+  else if(average_ < RECOVER_FRACTION * budget_ && level_ > 0)
+  {
+    set_level(level_ - 1);
+  }
+  return level != level_;
+}
+
+int QualityScheduler::level() const
+{
+  return level_;
+}
+
+int QualityScheduler::row_stride() const
+{
+  return ROW_STRIDES[level_];
+}
+
+void QualityScheduler::set_level(const int level)
+{
+  if(level != level_)
+  {
+    settle_ = SETTLE_FRAMES;
+  }
+  level_ = level;
+  frame_ = 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/ScanDiagnostics.h>
+#include <diagnostic_msgs/KeyValue.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  const char* METRIC_NAMES[ScanDiagnostics::NUM_METRICS] = {"invalid_pixels", "row_limit_pixels", "min_depth_pixels",
+                                                            "no_return_beams", "single_pixel_beams"};
+
+  void addValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, const double value)
+  {
+    diagnostic_msgs::KeyValue kv;
+    kv.key = key;
+    std::stringstream ss;
+    ss << value;
+    kv.value = ss.str();
+    status.values.push_back(kv);
+  }
+}
+
+ScanDiagnostics::ScanDiagnostics():
+  period_(1.0), trend_window_(60.0), frames_(0), sum_(), trend_valid_(false)
+{
+  std::fill(trend_, trend_ + NUM_METRICS, 0.0);
+}
+
+void ScanDiagnostics::configure(const std::string& name, const double period, const double trend_window)
+{
+  name_ = name;
+  period_ = std::max(period, 0.01);
+  trend_window_ = std::max(trend_window, period_);
+}
+
+void ScanDiagnostics::add(const ConversionStats& stats)
+{
+  frames_++;
+  sum_.pixels += stats.pixels;
+  sum_.valid += stats.valid;
+  sum_.accepted += stats.accepted;
+  sum_.rejected_row_limits += stats.rejected_row_limits;
+  sum_.rejected_min_depth += stats.rejected_min_depth;
+  sum_.beams += stats.beams;
+  sum_.no_return_beams += stats.no_return_beams;
+  sum_.single_pixel_beams += stats.single_pixel_beams;
+}
+
+bool ScanDiagnostics::report(const ros::Time& now, diagnostic_msgs::DiagnosticStatus& status)
+{
+  if(last_report_.isZero())
+  {
+    last_report_ = now; // Start of the first period
+    return false;
+  }
+
+  const double elapsed = (now - last_report_).toSec();
+  if(elapsed < period_)
+  {
+    return false;
+  }
+  last_report_ = now;
+
+  status = diagnostic_msgs::DiagnosticStatus();
+  status.name = name_ + ": scan data quality";
+  status.hardware_id = name_;
+  addValue(status, "frames", frames_);
+
+  const ConversionStats sum = sum_;
+  const int frames = frames_;
+  frames_ = 0;
+  sum_ = ConversionStats();
+
+  if(frames == 0 || sum.pixels == 0 || sum.beams == 0)
+  {
+    status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = "No conversion statistics (no frames, or a mode that doesn't collect them)";
+    return true;
+  }
+
+  const double pixels = sum.pixels;
+  const double beams = sum.beams;
+  double current[NUM_METRICS];
+  current[INVALID_PIXELS] = (sum.pixels - sum.valid) / pixels;
+  current[ROW_LIMIT_PIXELS] = sum.rejected_row_limits / pixels;
+  current[MIN_DEPTH_PIXELS] = sum.rejected_min_depth / pixels;
+  current[NO_RETURN_BEAMS] = sum.no_return_beams / beams;
+  current[SINGLE_PIXEL_BEAMS] = sum.single_pixel_beams / beams;
+
+  // Weight of the current period in the trend, so that the trend forgets with a time constant of trend_window_
+  const double weight = trend_valid_ ? 1.0 - std::exp(-elapsed / trend_window_) : 1.0;
+  trend_valid_ = true;
+
+  for(int i = 0; i < NUM_METRICS; ++i)
+  {
+    trend_[i] += weight * (current[i] - trend_[i]);
+    addValue(status, METRIC_NAMES[i], current[i]);
+    addValue(status, std::string(METRIC_NAMES[i]) + "_trend", trend_[i]);
+    addValue(status, std::string(METRIC_NAMES[i]) + "_deviation", current[i] - trend_[i]);
+  }
+
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  std::stringstream ss;
+  ss.precision(3);
+  ss << frames << " frames, " << current[INVALID_PIXELS] * 100 << "% invalid pixels, "
+     << current[NO_RETURN_BEAMS] * 100 << "% beams without return";
+  status.message = ss.str();
+  return true;
+}
@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/WorkStealingPool.h>
+#include <boost/bind/bind.hpp>
+#include <boost/make_shared.hpp>
+#include <limits>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  // Index of the pool worker running on this thread, -1 for other threads
+  thread_local int worker_index = -1;
+  thread_local const WorkStealingPool* worker_pool = NULL;
+}
+
+WorkStealingPool::WorkStealingPool(const int num_threads):
+  forked_jobs_(0), stopped_(false)
+{
+  int n = std::max(num_threads, 1);
+  for(int i = 0; i <= n; ++i) // The last deque holds the jobs forked by threads outside of the pool
+  {
+    workers_.push_back(boost::make_shared<Worker>());
+  }
+  for(int i = 0; i < n; ++i)
+  {
+    threads_.create_thread(boost::bind(&WorkStealingPool::work, this, i));
+  }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  shutdown();
+}
+
+void WorkStealingPool::shutdown()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if(stopped_)
+    {
+      return;
+    }
+    stopped_ = true;
+    for(size_t i = 0; i < streams_.size(); ++i)
+    {
+      streams_[i].pending.clear();
+    }
+  }
+  wake_.notify_all();
+  finished_.notify_all();
+  threads_.join_all();
+}
+
+int WorkStealingPool::num_threads() const
+{
+  return workers_.size() - 1;
+}
+
+int WorkStealingPool::add_stream(const double priority)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+
+  // Start at the smallest current pass so that a new stream doesn't monopolize the pool to catch up
+  double pass = std::numeric_limits<double>::infinity();
+  for(size_t i = 0; i < streams_.size(); ++i)
+  {
+    pass = std::min(pass, streams_[i].pass);
+  }
+
+  Stream stream;
+  stream.stride = 1.0 / std::max(priority, 1e-3);
+  stream.pass = streams_.empty() ? 0 : pass;
+  stream.running = false;
+  streams_.push_back(stream);
+  return streams_.size() - 1;
+}
+
+void WorkStealingPool::submit(const int stream, const Task& task)
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    if(stopped_)
+    {
+      return;
+    }
+    streams_[stream].pending = task; // Replaces a frame that hasn't started yet
+  }
+  wake_.notify_one();
+}
+
+bool WorkStealingPool::run(const int stream, const Task& task)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if(stopped_)
+  {
+    return false;
+  }
+  
+  bool done = false; // Set by the worker under mutex_, so it outlives the task
+  streams_[stream].pending = [&]()
+  {
+    task();
+    boost::mutex::scoped_lock done_lock(mutex_);
+    done = true;
+  };
+  wake_.notify_one();
+  
+  // Shutdown drops the task only if it hasn't been taken; once taken, it runs to completion before the workers exit
+  while(!done && !(stopped_ && !streams_[stream].pending && !streams_[stream].running))
+  {
+    finished_.wait(lock);
+  }
+  return done;
+}
+
+void WorkStealingPool::finish(const Job& job)
+{
+  Completion& completion = *job.completion;
+  boost::mutex::scoped_lock lock(completion.mutex);
+  if(--completion.remaining == 0)
+  {
+    completion.done.notify_all(); // Under the lock: the caller can't return and destroy completion before this
+  }
+}
+
+void WorkStealingPool::run_parallel(const std::vector<Task>& tasks)
+{
+  if(tasks.empty())
+  {
+    return;
+  }
+
+  if(tasks.size() == 1)
+  {
+    tasks[0]();
+    return;
+  }
+
+  const int index = (worker_pool == this) ? worker_index : num_threads();
+
+  Completion completion;
+  completion.remaining = tasks.size() - 1;
+  {
+    Worker& worker = *workers_[index];
+    boost::mutex::scoped_lock lock(worker.mutex);
+    for(size_t i = 1; i < tasks.size(); ++i)
+    {
+      Job job = {tasks[i], &completion};
+      worker.jobs.push_back(job);
+    }
+  }
+  forked_jobs_ += tasks.size() - 1;
+  {
+    // Taking the lock orders the notification after any worker's check of forked_jobs_ before it waits
+    boost::mutex::scoped_lock lock(mutex_);
+  }
+  wake_.notify_all();
+
+  tasks[0]();
+
+  // Help with the remaining jobs (ours, or stolen ones) while there are any to take
+  Job job;
+  while(find_job(index, job))
+  {
+    job.task();
+    finish(job);
+  }
+  
+  // Our last jobs are running on other workers
+  boost::mutex::scoped_lock lock(completion.mutex);
+  while(completion.remaining > 0)
+  {
+    completion.done.wait(lock);
+  }
+}
+
+bool WorkStealingPool::find_job(const int index, Job& job)
+{
+  const int n = workers_.size();
+  for(int k = 0; k < n; ++k)
+  {
+    Worker& worker = *workers_[(index + k) % n];
+    boost::mutex::scoped_lock lock(worker.mutex);
+    if(worker.jobs.empty())
+    {
+      continue;
+    }
+    if(k == 0)
+    {
+      job = worker.jobs.back(); // Own deque: newest first, its data is still in cache
+      worker.jobs.pop_back();
+    }
+    else
+    {
+      job = worker.jobs.front(); // Steal the oldest job
+      worker.jobs.pop_front();
+    }
+    --forked_jobs_;
+    return true;
+  }
+  return false;
+}
+
+int WorkStealingPool::next_stream(Task& task)
+{
+  int best = -1;
+  for(size_t i = 0; i < streams_.size(); ++i)
+  {
+    const Stream& stream = streams_[i];
+    if(stream.pending && !stream.running && (best < 0 || stream.pass < streams_[best].pass))
+    {
+      best = i;
+    }
+  }
+  if(best >= 0)
+  {
+    Stream& stream = streams_[best];
+    task.swap(stream.pending);
+    stream.running = true;
+    stream.pass += stream.stride;
+  }
+  return best;
+}
+
+void WorkStealingPool::work(const int index)
+{
+  worker_index = index;
+  worker_pool = this;
+
+  while(true)
+  {
+    Job job;
+    if(find_job(index, job))
+    {
+      job.task();
+      finish(job);
+      continue;
+    }
+
+    Task task;
+    int stream = -1;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while(!stopped_ && forked_jobs_ == 0 && (stream = next_stream(task)) < 0)
+      {
+        wake_.wait(lock);
+      }
+      if(stopped_)
+      {
+        return;
+      }
+      if(!task)
+      {
+        continue; // Woken for forked jobs
+      }
+    }
+
+    task();
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      streams_[stream].running = false;
+    }
+    wake_.notify_one(); // The stream may have a pending frame that had to wait for this one
+    finished_.notify_all();
+  }
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+/*
+ * Measures the conversion time of a recorded depth stream (see depth_capture.h and DepthCaptureNodelet) without ROS,
+ * transport or I/O in the loop: the capture is memory-mapped and preloaded, and every frame is converted in place with
+ * DepthImageToLaserScan::convert_buffer.
+ *
+ * Usage: capture_benchmark <capture file> [scan_height] [approach] [rounds]
+ *
+ * Prints the mean/p50/p99/max time per frame over all rounds, and an FNV-1a checksum of the ranges of every scan of
+ * the first round, which stays the same as long as changes to the kernels don't change their output. The warm-up
+ * frames (the first one, which builds the conversion tables, and those KERNEL_AUTO times the candidate kernels on) are
+ * left out of the statistics and reported separately.
+ */
+
+#include <full_depthimage_to_laserscan/DepthImageToLaserScan.h>
+#include <full_depthimage_to_laserscan/depth_capture.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  double percentile(const std::vector<double>& sorted, double p)
+  {
+    size_t index = std::min(sorted.size() - 1, (size_t)(p * sorted.size()));
+    return sorted[index];
+  }
+
+  uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+  {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for(size_t i = 0; i < size; ++i)
+    {
+      hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+  }
+}
+
+int main(int argc, char **argv){
+  if(argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <capture file> [scan_height] [approach] [rounds]" << std::endl;
+    return 1;
+  }
+  const int scan_height = argc > 2 ? atoi(argv[2]) : 1;
+  const int approach = argc > 3 ? atoi(argv[3]) : DepthImageToLaserScan::KERNEL_AUTO;
+  const int rounds = argc > 4 ? std::max(atoi(argv[4]), 1) : 10;
+
+  DepthCaptureReader reader;
+  try
+  {
+    reader.open(argv[1]);
+  }
+  catch(std::runtime_error& e)
+  {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if(reader.num_frames() == 0)
+  {
+    std::cerr << argv[1] << " contains no frames" << std::endl;
+    return 1;
+  }
+
+  DepthImageToLaserScan dtl;
+  dtl.set_scan_time(0.033);
+  dtl.set_range_limits(0.45, 10.0);
+  dtl.set_scan_height(scan_height);
+  dtl.set_output_frame("camera_depth_frame");
+  dtl.set_filtering_limits(0.25, 0.15);
+
+  sensor_msgs::ImagePtr frame = reader.image();
+  const sensor_msgs::CameraInfoConstPtr& info = reader.camera_info();
+  std::vector<double> times, warmup_times;
+  times.reserve(rounds * reader.num_frames());
+  uint64_t checksum = 14695981039346656037ull;
+
+  for(int round = 0; round < rounds; ++round)
+  {
+    for(size_t i = 0; i < reader.num_frames(); ++i)
+    {
+      const uint8_t* pixels = reader.frame(i, *frame);
+      sensor_msgs::ImageConstPtr image;
+      const bool warmup = (round == 0 && i == 0) ||
+        (approach == DepthImageToLaserScan::KERNEL_AUTO && dtl.tuned_kernel() == DepthImageToLaserScan::KERNEL_AUTO);
+
+      ros::WallTime start = ros::WallTime::now();
+      sensor_msgs::LaserScanPtr scan = dtl.convert_buffer(frame, pixels, info, approach, image);
+      (warmup ? warmup_times : times).push_back((ros::WallTime::now() - start).toSec());
+
+      if(round == 0)
+      {
+        checksum = fnv1a(checksum, scan->ranges.data(), scan->ranges.size() * sizeof(float));
+      }
+    }
+  }
+
+  if(times.empty())
+  {
+    std::cerr << "All " << warmup_times.size() << " frames were spent warming up; use more rounds" << std::endl;
+    return 1;
+  }
+  double warmup_mean = 0;
+  for(size_t i = 0; i < warmup_times.size(); ++i)
+  {
+    warmup_mean += warmup_times[i];
+  }
+  warmup_mean /= warmup_times.size();
+
+  std::vector<double> sorted(times);
+  double mean = 0;
+  for(size_t i = 0; i < sorted.size(); ++i)
+  {
+    mean += sorted[i];
+  }
+  mean /= sorted.size();
+  std::sort(sorted.begin(), sorted.end());
+
+  int kernel = (approach == DepthImageToLaserScan::KERNEL_AUTO) ? dtl.tuned_kernel() : approach;
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)checksum);
+  std::cout << reader.num_frames() << " frames " << frame->width << "x" << frame->height << " " << frame->encoding <<
+    ", scan_height " << scan_height << ", kernel " << kernel << ", " << rounds << " rounds: mean " << mean * 1e6 <<
+    " us, p50 " << percentile(sorted, 0.50) * 1e6 << " us, p99 " << percentile(sorted, 0.99) * 1e6 << " us, max " <<
+    sorted.back() * 1e6 << " us, checksum " << hex << "; " << warmup_times.size() << " warm-up frames excluded: mean " <<
+    warmup_mean * 1e6 << " us" << std::endl;
+
+  return 0;
+}
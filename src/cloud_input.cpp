@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/cloud_input.h>
+#include <sensor_msgs/PointField.h>
+#include <sensor_msgs/image_encodings.h>
+#include <boost/make_shared.hpp>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  const int ESTIMATE_SAMPLE_STEP = 4; ///< Rows and columns between the points used to estimate the intrinsics
+  const int ESTIMATE_MIN_POINTS = 64; ///< Fewest valid points the intrinsics are fitted to
+
+  /**
+   * Returns the offset of the named field in floats, checking that it can be read as a float of each point.
+   */
+  int float_field(const sensor_msgs::PointCloud2& cloud, const std::string& name)
+  {
+    for(size_t i = 0; i < cloud.fields.size(); ++i)
+    {
+      const sensor_msgs::PointField& field = cloud.fields[i];
+      if(field.name != name)
+      {
+        continue;
+      }
+      if(field.datatype != sensor_msgs::PointField::FLOAT32 || field.offset % sizeof(float) != 0)
+      {
+        throw std::runtime_error("Point cloud field " + name + " is not an aligned float32 field");
+      }
+      return field.offset / sizeof(float);
+    }
+    throw std::runtime_error("Point cloud has no " + name + " field");
+  }
+
+  /**
+   * Checks that the points of the cloud are an organized, little-endian array of floats.
+   */
+  void check_layout(const sensor_msgs::PointCloud2& cloud)
+  {
+    if(cloud.height < 2)
+    {
+      throw std::runtime_error("Point cloud is not organized (height < 2)");
+    }
+    if(cloud.is_bigendian)
+    {
+      throw std::runtime_error("Big-endian point clouds are not supported");
+    }
+    if(cloud.point_step % sizeof(float) != 0 || cloud.row_step % sizeof(float) != 0 ||
+      cloud.row_step < cloud.width*cloud.point_step || cloud.data.size() < (size_t)cloud.row_step*cloud.height)
+    {
+      std::stringstream ss;
+      ss << "Point cloud has an unsupported layout: point_step " << cloud.point_step << ", row_step " <<
+        cloud.row_step << ", " << cloud.data.size() << " bytes";
+      throw std::runtime_error(ss.str());
+    }
+  }
+
+  /**
+   * Least-squares fit of pixel = scale*ratio + offset. Returns false if the ratios don't vary enough.
+   */
+  bool fit_line(const double n, const double sum_ratio, const double sum_pixel, const double sum_ratio2,
+                const double sum_ratio_pixel, double& scale, double& offset)
+  {
+    const double denominator = n*sum_ratio2 - sum_ratio*sum_ratio;
+    if(!(denominator > 1e-12*n*n))
+    {
+      return false;
+    }
+    scale = (n*sum_ratio_pixel - sum_ratio*sum_pixel) / denominator;
+    offset = (sum_pixel - scale*sum_ratio) / n;
+    return scale > 0;
+  }
+}
+
+CloudDepthView full_depthimage_to_laserscan::cloud_depth_view(const sensor_msgs::PointCloud2& cloud)
+{
+  check_layout(cloud);
+
+  CloudDepthView view;
+  view.origin = reinterpret_cast<const float*>(cloud.data.data()) + float_field(cloud, "z");
+  view.col_step = cloud.point_step / sizeof(float);
+  view.row_step = cloud.row_step / sizeof(float);
+  view.width = cloud.width;
+  view.height = cloud.height;
+  return view;
+}
+
+sensor_msgs::CameraInfoPtr full_depthimage_to_laserscan::estimate_camera_info(const sensor_msgs::PointCloud2& cloud)
+{
+  check_layout(cloud);
+  const float* points = reinterpret_cast<const float*>(cloud.data.data());
+  const int x_offset = float_field(cloud, "x"), y_offset = float_field(cloud, "y"), z_offset = float_field(cloud, "z");
+  const int col_step = cloud.point_step / sizeof(float);
+  const int row_step = cloud.row_step / sizeof(float);
+
+  // Sums of the horizontal (x/z, u) and vertical (y/z, v) fits
+  double n = 0;
+  double sum_a = 0, sum_u = 0, sum_aa = 0, sum_au = 0;
+  double sum_b = 0, sum_v = 0, sum_bb = 0, sum_bv = 0;
+  for(int v = 0; v < (int)cloud.height; v += ESTIMATE_SAMPLE_STEP)
+  {
+    for(int u = 0; u < (int)cloud.width; u += ESTIMATE_SAMPLE_STEP)
+    {
+      const float* point = points + v*row_step + u*col_step;
+      const double z = point[z_offset];
+      if(!(z > 0) || !std::isfinite(z) || !std::isfinite(point[x_offset]) || !std::isfinite(point[y_offset]))
+      {
+        continue;
+      }
+      const double a = point[x_offset] / z, b = point[y_offset] / z;
+      n += 1;
+      sum_a += a; sum_u += u; sum_aa += a*a; sum_au += a*u;
+      sum_b += b; sum_v += v; sum_bb += b*b; sum_bv += b*v;
+    }
+  }
+
+  double fx = 0, cx = 0, fy = 0, cy = 0;
+  if(n < ESTIMATE_MIN_POINTS || !fit_line(n, sum_a, sum_u, sum_aa, sum_au, fx, cx) ||
+    !fit_line(n, sum_b, sum_v, sum_bb, sum_bv, fy, cy))
+  {
+    throw std::runtime_error("Point cloud has too few valid points to estimate its intrinsics");
+  }
+
+  sensor_msgs::CameraInfoPtr info = boost::make_shared<sensor_msgs::CameraInfo>();
+  info->header = cloud.header;
+  info->width = cloud.width;
+  info->height = cloud.height;
+
+  info->distortion_model = "plumb_bob";
+  info->D.assign(5, 0.0);
+
+  info->K[0] = fx; info->K[2] = cx;
+  info->K[4] = fy; info->K[5] = cy;
+  info->K[8] = 1;
+
+  info->R[0] = info->R[4] = info->R[8] = 1;
+
+  info->P[0] = fx; info->P[2] = cx;
+  info->P[5] = fy; info->P[6] = cy;
+  info->P[10] = 1;
+
+  return info;
+}
+
+sensor_msgs::ImagePtr full_depthimage_to_laserscan::cloud_image_geometry(const sensor_msgs::PointCloud2& cloud)
+{
+  sensor_msgs::ImagePtr image = boost::make_shared<sensor_msgs::Image>();
+  image->header = cloud.header;
+  image->encoding = sensor_msgs::image_encodings::TYPE_32FC1;
+  image->is_bigendian = false;
+  image->width = cloud.width;
+  image->height = cloud.height;
+  image->step = cloud.width * sizeof(float);
+  return image;
+}
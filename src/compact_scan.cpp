@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/compact_scan.h>
+#include <algorithm>
+#include <limits>
+
+using namespace full_depthimage_to_laserscan;
+
+CompactScanEncoder::CompactScanEncoder():
+  delta_(true), keyframe_interval_(30), tolerance_(0), sequence_(0), since_keyframe_(0)
+{
+}
+
+void CompactScanEncoder::configure(const bool delta, const int keyframe_interval, const uint16_t tolerance)
+{
+  delta_ = delta;
+  keyframe_interval_ = std::max(keyframe_interval, 1);
+  tolerance_ = tolerance;
+  since_keyframe_ = keyframe_interval_; // Start with a key frame
+}
+
+bool CompactScanEncoder::encode(const sensor_msgs::LaserScan& scan_msg, const std::vector<uint16_t>& ranges_mm, 
+                                CompactScan& compact_msg)
+{
+  compact_msg.header = scan_msg.header;
+  compact_msg.angle_min = scan_msg.angle_min;
+  compact_msg.angle_increment = scan_msg.angle_increment;
+  compact_msg.scan_time = scan_msg.scan_time;
+  compact_msg.range_min = scan_msg.range_min;
+  compact_msg.range_max = scan_msg.range_max;
+  compact_msg.num_beams = ranges_mm.size();
+  compact_msg.indices.clear();
+  
+  bool keyframe = !delta_ || since_keyframe_ >= keyframe_interval_ || reference_.size() != ranges_mm.size();
+  
+  if(keyframe)
+  {
+    compact_msg.encoding = CompactScan::ABSOLUTE;
+    compact_msg.ranges = ranges_mm;
+    reference_ = ranges_mm;
+    since_keyframe_ = 1;
+  }
+  else
+  {
+    compact_msg.encoding = CompactScan::DELTA;
+    compact_msg.ranges.clear();
+    for(size_t i = 0; i < ranges_mm.size(); ++i)
+    {
+      uint16_t a = ranges_mm[i], b = reference_[i];
+      // A beam gaining or losing its return always counts as a change
+      bool changed = (a == 0) != (b == 0) || std::max(a, b) - std::min(a, b) > tolerance_;
+      if(changed)
+      {
+        compact_msg.indices.push_back(i);
+        compact_msg.ranges.push_back(a);
+        reference_[i] = a;
+      }
+    }
+    if(compact_msg.indices.empty())
+    {
+      return false;
+    }
+    since_keyframe_++;
+  }
+  
+  compact_msg.sequence = sequence_++;
+  return true;
+}
+
+CompactScanDecoder::CompactScanDecoder():
+  synchronized_(false), sequence_(0)
+{
+}
+
+bool CompactScanDecoder::decode(const CompactScan& compact_msg, std::vector<uint16_t>& ranges_mm)
+{
+  if(compact_msg.encoding == CompactScan::ABSOLUTE)
+  {
+    ranges_ = compact_msg.ranges;
+    synchronized_ = true;
+  }
+  else if(synchronized_ && compact_msg.sequence == sequence_ + 1 && ranges_.size() == compact_msg.num_beams &&
+          compact_msg.indices.size() == compact_msg.ranges.size())
+  {
+    for(size_t i = 0; i < compact_msg.indices.size(); ++i)
+    {
+      uint16_t index = compact_msg.indices[i];
+      if(index < ranges_.size())
+      {
+        ranges_[index] = compact_msg.ranges[i];
+      }
+    }
+  }
+  else
+  {
+    synchronized_ = false; // Lost a message; wait for the next key frame
+  }
+  
+  sequence_ = compact_msg.sequence;
+  if(synchronized_)
+  {
+    ranges_mm = ranges_;
+  }
+  return synchronized_;
+}
+
+bool CompactScanDecoder::decode(const CompactScan& compact_msg, sensor_msgs::LaserScan& scan_msg)
+{
+  std::vector<uint16_t> ranges_mm;
+  if(!decode(compact_msg, ranges_mm))
+  {
+    return false;
+  }
+  
+  scan_msg.header = compact_msg.header;
+  scan_msg.angle_min = compact_msg.angle_min;
+  scan_msg.angle_increment = compact_msg.angle_increment;
+  scan_msg.angle_max = compact_msg.angle_min + compact_msg.angle_increment * ((int)ranges_mm.size() - 1);
+  scan_msg.time_increment = 0;
+  scan_msg.scan_time = compact_msg.scan_time;
+  scan_msg.range_min = compact_msg.range_min;
+  scan_msg.range_max = compact_msg.range_max;
+  scan_msg.ranges.resize(ranges_mm.size());
+  for(size_t i = 0; i < ranges_mm.size(); ++i)
+  {
+    scan_msg.ranges[i] = ranges_mm[i] ? ranges_mm[i] * 0.001f : std::numeric_limits<float>::quiet_NaN();
+  }
+  scan_msg.intensities.clear();
+  return true;
+}
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/depth_capture.h>
+#include <ros/serialization.h>
+#include <boost/make_shared.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  size_t round_up(const size_t size, const size_t alignment)
+  {
+    return (size + alignment - 1) / alignment * alignment;
+  }
+
+  void throw_errno(const std::string& what, const std::string& path)
+  {
+    std::stringstream ss;
+    ss << what << " " << path << ": " << strerror(errno);
+    throw std::runtime_error(ss.str());
+  }
+
+  bool write_all(const int fd, const uint8_t* data, size_t size)
+  {
+    while(size > 0)
+    {
+      ssize_t written = ::write(fd, data, size);
+      if(written < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      if(written <= 0)
+      {
+        return false;
+      }
+      data += written;
+      size -= written;
+    }
+    return true;
+  }
+}
+
+DepthCaptureWriter::DepthCaptureWriter():
+  fd_(-1), num_frames_(0)
+{
+  memset(&header_, 0, sizeof(header_));
+}
+
+DepthCaptureWriter::~DepthCaptureWriter()
+{
+  close();
+}
+
+void DepthCaptureWriter::open(const std::string& path, const sensor_msgs::Image& image, const sensor_msgs::CameraInfo& info)
+{
+  close();
+
+  if(image.encoding.size() >= sizeof(header_.encoding))
+  {
+    throw std::runtime_error("Unsupported encoding for a depth capture: " + image.encoding);
+  }
+
+  sensor_msgs::CameraInfo stored = info;
+  stored.header = image.header;
+  const uint32_t info_size = ros::serialization::serializationLength(stored);
+
+  memset(&header_, 0, sizeof(header_));
+  memcpy(header_.magic, CAPTURE_MAGIC, sizeof(header_.magic));
+  header_.version = CAPTURE_VERSION;
+  header_.width = image.width;
+  header_.height = image.height;
+  header_.step = image.step;
+  strncpy(header_.encoding, image.encoding.c_str(), sizeof(header_.encoding) - 1);
+  header_.info_size = info_size;
+  header_.frames_offset = round_up(sizeof(header_) + info_size, CAPTURE_PAGE_SIZE);
+  header_.frame_stride = round_up(CAPTURE_FRAME_HEADER_SIZE + (size_t)image.height*image.step, CAPTURE_FRAME_HEADER_SIZE);
+
+  // Header, calibration and padding up to the first frame
+  std::vector<uint8_t> prefix(header_.frames_offset, 0);
+  memcpy(prefix.data(), &header_, sizeof(header_));
+  ros::serialization::OStream stream(prefix.data() + sizeof(header_), info_size);
+  ros::serialization::serialize(stream, stored);
+
+  fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd_ < 0)
+  {
+    throw_errno("Failed to create", path);
+  }
+  if(!write_all(fd_, prefix.data(), prefix.size()))
+  {
+    close();
+    throw_errno("Failed to write", path);
+  }
+
+  record_.assign(header_.frame_stride, 0);
+  num_frames_ = 0;
+}
+
+bool DepthCaptureWriter::is_open() const
+{
+  return fd_ >= 0;
+}
+
+bool DepthCaptureWriter::write(const sensor_msgs::Image& image)
+{
+  if(fd_ < 0 || image.width != header_.width || image.height != header_.height || image.step != header_.step ||
+     image.encoding != header_.encoding || image.data.size() < (size_t)image.height*image.step)
+  {
+    return false;
+  }
+
+  CaptureFrameHeader frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.stamp = image.header.stamp.toNSec();
+  frame.seq = image.header.seq;
+  memcpy(record_.data(), &frame, sizeof(frame));
+  memcpy(record_.data() + CAPTURE_FRAME_HEADER_SIZE, image.data.data(), (size_t)image.height*image.step);
+
+  if(!write_all(fd_, record_.data(), record_.size()))
+  {
+    throw std::runtime_error(std::string("Failed to write a depth capture frame: ") + strerror(errno));
+  }
+  ++num_frames_;
+  return true;
+}
+
+void DepthCaptureWriter::close()
+{
+  if(fd_ >= 0)
+  {
+    ::close(fd_);
+  }
+  fd_ = -1;
+}
+
+uint64_t DepthCaptureWriter::num_frames() const
+{
+  return num_frames_;
+}
+
+DepthCaptureReader::DepthCaptureReader():
+  map_(NULL), size_(0), num_frames_(0)
+{
+  memset(&header_, 0, sizeof(header_));
+}
+
+DepthCaptureReader::~DepthCaptureReader()
+{
+  close();
+}
+
+void DepthCaptureReader::open(const std::string& path, const bool preload)
+{
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+  {
+    throw_errno("Failed to open", path);
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0)
+  {
+    ::close(fd);
+    throw_errno("Failed to stat", path);
+  }
+  if((size_t)st.st_size < sizeof(header_))
+  {
+    ::close(fd);
+    throw std::runtime_error(path + " is not a depth capture");
+  }
+
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | (preload ? MAP_POPULATE : 0), fd, 0);
+  ::close(fd); // The mapping keeps the file open
+  if(map == MAP_FAILED)
+  {
+    throw_errno("Failed to map", path);
+  }
+  map_ = static_cast<const uint8_t*>(map);
+  size_ = st.st_size;
+  if(!preload)
+  {
+    madvise(map, size_, MADV_SEQUENTIAL);
+  }
+
+  memcpy(&header_, map_, sizeof(header_));
+  if(memcmp(header_.magic, CAPTURE_MAGIC, sizeof(header_.magic)) != 0 || header_.version != CAPTURE_VERSION ||
+     header_.frames_offset < sizeof(header_) + header_.info_size || header_.frames_offset > size_ ||
+     header_.frame_stride < CAPTURE_FRAME_HEADER_SIZE + (uint64_t)header_.height*header_.step ||
+     header_.frames_offset % CAPTURE_PAGE_SIZE != 0 || header_.frame_stride % CAPTURE_FRAME_HEADER_SIZE != 0 ||
+     header_.encoding[sizeof(header_.encoding) - 1] != '\0')
+  {
+    close();
+    throw std::runtime_error(path + " is not a depth capture of version " + std::to_string(CAPTURE_VERSION));
+  }
+
+  sensor_msgs::CameraInfoPtr info = boost::make_shared<sensor_msgs::CameraInfo>();
+  try
+  {
+    ros::serialization::IStream stream(const_cast<uint8_t*>(map_) + sizeof(header_), header_.info_size);
+    ros::serialization::deserialize(stream, *info);
+  }
+  catch(const ros::Exception& e)
+  {
+    close();
+    throw std::runtime_error(path + " has a corrupt camera_info: " + e.what());
+  }
+  info_ = info;
+
+  num_frames_ = (size_ - header_.frames_offset) / header_.frame_stride;
+}
+
+void DepthCaptureReader::close()
+{
+  if(map_)
+  {
+    munmap(const_cast<uint8_t*>(map_), size_);
+  }
+  map_ = NULL;
+  size_ = 0;
+  num_frames_ = 0;
+  info_.reset();
+}
+
+size_t DepthCaptureReader::num_frames() const
+{
+  return num_frames_;
+}
+
+const sensor_msgs::CameraInfoConstPtr& DepthCaptureReader::camera_info() const
+{
+  return info_;
+}
+
+sensor_msgs::ImagePtr DepthCaptureReader::image() const
+{
+  sensor_msgs::ImagePtr image = boost::make_shared<sensor_msgs::Image>();
+  if(info_)
+  {
+    image->header = info_->header;
+  }
+  image->width = header_.width;
+  image->height = header_.height;
+  image->step = header_.step;
+  image->encoding = header_.encoding;
+  image->is_bigendian = false;
+  return image;
+}
+
+const uint8_t* DepthCaptureReader::frame(const size_t i, sensor_msgs::Image& image) const
+{
+  if(i >= num_frames_)
+  {
+    throw std::out_of_range("Depth capture frame index out of range");
+  }
+  const uint8_t* record = map_ + header_.frames_offset + i*header_.frame_stride;
+
+  CaptureFrameHeader frame;
+  memcpy(&frame, record, sizeof(frame));
+  image.header.stamp.fromNSec(frame.stamp);
+  image.header.seq = frame.seq;
+  return record + CAPTURE_FRAME_HEADER_SIZE;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/image_rotation.h>
+#include <boost/make_shared.hpp>
+
+using namespace full_depthimage_to_laserscan;
+
+sensor_msgs::CameraInfoPtr full_depthimage_to_laserscan::rotate_camera_info(const sensor_msgs::CameraInfo& info,
+                                                                            const int rotation)
+{
+  sensor_msgs::CameraInfoPtr rotated = boost::make_shared<sensor_msgs::CameraInfo>();
+  rotated->header = info.header;
+
+  const double w = info.width, h = info.height;
+  const double fx = info.P[0], fy = info.P[5], cx = info.P[2], cy = info.P[6];
+
+  // Focal lengths and principal point of the rotated pixel grid (see rotated_view for the pixel mapping)
+  double rfx = fx, rfy = fy, rcx = cx, rcy = cy;
+  switch(rotation)
+  {
+    case 90:
+      rfx = fy; rcx = h-1 - cy;
+      rfy = fx; rcy = cx;
+      break;
+    case 180:
+      rcx = w-1 - cx;
+      rcy = h-1 - cy;
+      break;
+    case 270:
+      rfx = fy; rcx = cy;
+      rfy = fx; rcy = w-1 - cx;
+      break;
+  }
+
+  const bool transposed = (rotation == 90 || rotation == 270);
+  rotated->width = transposed ? info.height : info.width;
+  rotated->height = transposed ? info.width : info.height;
+
+  rotated->distortion_model = "plumb_bob";
+  rotated->D.assign(5, 0.0);
+
+  rotated->K[0] = rfx; rotated->K[2] = rcx;
+  rotated->K[4] = rfy; rotated->K[5] = rcy;
+  rotated->K[8] = 1;
+
+  rotated->R[0] = rotated->R[4] = rotated->R[8] = 1;
+
+  rotated->P[0] = rfx; rotated->P[2] = rcx;
+  rotated->P[5] = rfy; rotated->P[6] = rcy;
+  rotated->P[10] = 1;
+
+  return rotated;
+}
+
+sensor_msgs::ImagePtr full_depthimage_to_laserscan::rotate_image_geometry(const sensor_msgs::Image& image,
+                                                                          const int rotation)
+{
+  sensor_msgs::ImagePtr rotated = boost::make_shared<sensor_msgs::Image>();
+  rotated->header = image.header;
+  rotated->encoding = image.encoding;
+  rotated->is_bigendian = image.is_bigendian;
+
+  const bool transposed = (rotation == 90 || rotation == 270);
+  rotated->width = transposed ? image.height : image.width;
+  rotated->height = transposed ? image.width : image.height;
+  rotated->step = rotated->width * (image.width > 0 ? image.step / image.width : 0); // Bytes per pixel are unchanged
+  return rotated;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+/*
+ * Measures the end-to-end latency of the converter: from the header stamp of each depth image (set by
+ * replay_publisher when it is published) to the reception of the corresponding scan.
+ * 
+ * Once no scan has arrived for 'idle_timeout' seconds after the first one, the throughput, p50/p99 latency and drop
+ * rate are printed and, if 'output' is set, appended as a CSV line to that file.
+ */
+
+#include <ros/ros.h>
+#include <sensor_msgs/LaserScan.h>
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+  std::vector<double> latencies_; ///< Latency of each received scan (in seconds)
+  ros::WallTime first_, last_;
+  
+  void scanCb(const sensor_msgs::LaserScanConstPtr& scan_msg)
+  {
+    ros::Time now = ros::Time::now();
+    last_ = ros::WallTime::now();
+    if(latencies_.empty())
+    {
+      first_ = last_;
+    }
+    latencies_.push_back((now - scan_msg->header.stamp).toSec());
+  }
+  
+  double percentile(const std::vector<double>& sorted, double p)
+  {
+    if(sorted.empty())
+    {
+      return std::numeric_limits<double>::quiet_NaN();
+    }
+    size_t index = std::min(sorted.size() - 1, (size_t)(p * sorted.size()));
+    return sorted[index];
+  }
+}
+
+int main(int argc, char **argv){
+  ros::init(argc, argv, "latency_monitor");
+  ros::NodeHandle n;
+  ros::NodeHandle pnh("~");
+  
+  int expected_frames = 1000, warmup_frames = 30;
+  double idle_timeout = 3.0;
+  std::string label = "default", output;
+  pnh.getParam("expected_frames", expected_frames);
+  pnh.getParam("warmup_frames", warmup_frames);
+  pnh.getParam("idle_timeout", idle_timeout);
+  pnh.getParam("label", label);
+  pnh.getParam("output", output);
+  
+  ros::Subscriber sub = n.subscribe("scan", 100, scanCb, ros::TransportHints().tcpNoDelay());
+  
+  ros::Rate loop(100);
+  while(ros::ok())
+  {
+    ros::spinOnce();
+    if(!latencies_.empty() && (ros::WallTime::now() - last_).toSec() > idle_timeout)
+    {
+      break;
+    }
+    if((int)latencies_.size() >= expected_frames)
+    {
+      break;
+    }
+    loop.sleep();
+  }
+  
+  size_t received = latencies_.size();
+  if(received == 0)
+  {
+    ROS_ERROR("No scans received");
+    return 1;
+  }
+  
+  // Throughput over the whole run; latency statistics exclude the warm-up frames (cache construction, connections)
+  double duration = (last_ - first_).toSec();
+  double throughput = duration > 0 ? (received - 1) / duration : 0;
+  double drop_rate = 1.0 - std::min(1.0, (double)received / expected_frames);
+  
+  std::vector<double> sorted(latencies_.begin() + std::min(received - 1, (size_t)std::max(warmup_frames, 0)), latencies_.end());
+  std::sort(sorted.begin(), sorted.end());
+  double p50 = percentile(sorted, 0.50) * 1e3;
+  double p99 = percentile(sorted, 0.99) * 1e3;
+  double max = sorted.back() * 1e3;
+  
+  ROS_INFO_STREAM("[" << label << "] received " << received << "/" << expected_frames << " scans, throughput " << 
+                  throughput << " Hz, latency p50 " << p50 << " ms, p99 " << p99 << " ms, max " << max << 
+                  " ms, drop rate " << drop_rate * 100 << "%");
+  
+  if(!output.empty())
+  {
+    std::ofstream file(output.c_str(), std::ios::app);
+    file << label << "," << received << "," << expected_frames << "," << throughput << "," << p50 << "," << p99 << 
+      "," << max << "," << drop_rate << std::endl;
+  }
+  
+  return 0;
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/perf_counters.h>
+
+#ifdef FULL_DEPTHIMAGE_TO_LASERSCAN_PERF_COUNTERS
+
+#include <ros/console.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  const char* STAGE_NAMES[PerfProfiler::NUM_STAGES] = {"update_cache", "convert", "assemble"};
+
+  const char* COUNTER_NAMES[PerfProfiler::NUM_COUNTERS] = {"cycles", "instructions", "LLC misses", "branch misses"};
+
+  const uint64_t COUNTER_CONFIGS[PerfProfiler::NUM_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+  int open_counter(const uint64_t config, const int group_fd)
+  {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1; // Allowed with perf_event_paranoid <= 2
+    attr.exclude_hv = 1;
+
+    // Calling thread only, on any CPU
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+  }
+}
+
+PerfProfiler::PerfProfiler():
+  requested_(false), pixels_(0), frames_(0)
+{
+  for(int s = 0; s < NUM_STAGES; ++s)
+  {
+    running_[s] = NULL;
+  }
+  memset(totals_, 0, sizeof(totals_));
+}
+
+PerfProfiler::~PerfProfiler()
+{
+  close();
+}
+
+bool PerfProfiler::enabled() const
+{
+  return requested_;
+}
+
+void PerfProfiler::set_enabled(const bool enabled)
+{
+  // Only a request: the counters count the thread that opens them, which is the converting thread, not the caller
+  requested_ = enabled;
+}
+
+PerfProfiler::Counters* PerfProfiler::thread_counters()
+{
+  if(!requested_)
+  {
+    close();
+    return NULL;
+  }
+
+  if(counters_.empty())
+  {
+    memset(totals_, 0, sizeof(totals_));
+    pixels_ = 0;
+    frames_ = 0;
+  }
+
+  const boost::thread::id thread = boost::this_thread::get_id();
+  std::map<boost::thread::id, Counters>::iterator it = counters_.find(thread);
+  if(it == counters_.end())
+  {
+    Counters counters;
+    if(!open(counters))
+    {
+      requested_ = false;
+      close();
+      return NULL;
+    }
+    it = counters_.insert(std::make_pair(thread, counters)).first;
+  }
+  return &it->second;
+}
+
+bool PerfProfiler::open(Counters& counters)
+{
+  counters.num_open = 0;
+  for(int i = 0; i < NUM_COUNTERS; ++i)
+  {
+    counters.fds[i] = -1;
+    counters.positions[i] = -1;
+  }
+
+  counters.leader = open_counter(COUNTER_CONFIGS[COUNTER_CYCLES], -1);
+  if(counters.leader < 0)
+  {
+    const bool denied = (errno == EACCES || errno == EPERM);
+    ROS_WARN_STREAM("Performance counters unavailable (" << strerror(errno) << "), profiling disabled" << 
+                    (denied ? "; check /proc/sys/kernel/perf_event_paranoid" : ""));
+    return false;
+  }
+
+  std::stringstream missing;
+  for(int i = 0; i < NUM_COUNTERS; ++i)
+  {
+    int fd = (i == COUNTER_CYCLES) ? counters.leader : open_counter(COUNTER_CONFIGS[i], counters.leader);
+    if(fd < 0)
+    {
+      missing << (missing.str().empty() ? "" : ", ") << COUNTER_NAMES[i];
+      continue;
+    }
+    counters.fds[i] = fd;
+    counters.positions[i] = counters.num_open++;
+  }
+  if(!missing.str().empty())
+  {
+    ROS_WARN_STREAM("Performance counters unavailable, reported as 0: " << missing.str());
+  }
+  return true;
+}
+
+void PerfProfiler::close()
+{
+  for(std::map<boost::thread::id, Counters>::iterator it = counters_.begin(); it != counters_.end(); ++it)
+  {
+    for(int i = 0; i < NUM_COUNTERS; ++i)
+    {
+      if(it->second.fds[i] >= 0)
+      {
+        ::close(it->second.fds[i]);
+      }
+    }
+  }
+  counters_.clear();
+  for(int s = 0; s < NUM_STAGES; ++s)
+  {
+    running_[s] = NULL;
+  }
+}
+
+bool PerfProfiler::read(const Counters& counters, uint64_t* values)
+{
+  // PERF_FORMAT_GROUP: the number of counters, followed by their values in the order they were opened
+  uint64_t buffer[1 + NUM_COUNTERS];
+  ssize_t size = ::read(counters.leader, buffer, sizeof(buffer));
+  if(size < (ssize_t)sizeof(uint64_t) || (int)buffer[0] != counters.num_open)
+  {
+    return false;
+  }
+  for(int i = 0; i < NUM_COUNTERS; ++i)
+  {
+    values[i] = (counters.positions[i] >= 0) ? buffer[1 + counters.positions[i]] : 0;
+  }
+  return true;
+}
+
+void PerfProfiler::begin(const Stage stage)
+{
+  Counters* counters = thread_counters();
+  if(counters && !read(*counters, start_[stage]))
+  {
+    ROS_WARN("Reading the performance counters failed, profiling disabled");
+    requested_ = false;
+    close();
+    counters = NULL;
+  }
+  running_[stage] = counters;
+}
+
+void PerfProfiler::end(const Stage stage)
+{
+  uint64_t values[NUM_COUNTERS];
+  Counters* counters = running_[stage];
+  running_[stage] = NULL;
+  if(!counters || !read(*counters, values))
+  {
+    return;
+  }
+  for(int i = 0; i < NUM_COUNTERS; ++i)
+  {
+    totals_[stage][i] += values[i] - start_[stage][i];
+  }
+}
+
+void PerfProfiler::end_frame(const uint64_t pixels)
+{
+  if(counters_.empty())
+  {
+    return;
+  }
+
+  pixels_ += pixels;
+  if(++frames_ < REPORT_FRAMES)
+  {
+    return;
+  }
+
+  std::stringstream ss;
+  ss.precision(3);
+  ss << "Performance counters over " << frames_ << " frames:";
+  for(int s = 0; s < NUM_STAGES; ++s)
+  {
+    const uint64_t* totals = totals_[s];
+    ss << "\n  " << STAGE_NAMES[s] << ": " << (double)totals[COUNTER_CYCLES] / std::max(pixels_, (uint64_t)1)
+       << " cycles/pixel, " << (double)totals[COUNTER_INSTRUCTIONS] / std::max(totals[COUNTER_CYCLES], (uint64_t)1)
+       << " instructions/cycle, " << (double)totals[COUNTER_LLC_MISSES] / frames_ << " LLC misses/frame, "
+       << (double)totals[COUNTER_BRANCH_MISSES] / frames_ << " branch misses/frame";
+  }
+  ROS_INFO_STREAM(ss.str());
+
+  memset(totals_, 0, sizeof(totals_));
+  pixels_ = 0;
+  frames_ = 0;
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/pooled_image.h>
+#include <full_depthimage_to_laserscan/aligned_allocator.h>
+#include <boost/make_shared.hpp>
+
+using namespace full_depthimage_to_laserscan;
+
+const size_t ImageBufferPool::MIN_POOLED_SIZE;
+const size_t ImageBufferPool::MAX_POOLED_BUFFERS;
+
+ImageBufferPool& ImageBufferPool::instance()
+{
+  // Never destroyed, as messages may still release their buffers during static destruction
+  static ImageBufferPool* pool = new ImageBufferPool();
+  return *pool;
+}
+
+void* ImageBufferPool::allocate(const size_t size)
+{
+  if(size >= MIN_POOLED_SIZE)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    // The most recently released buffer is the most likely to still be in the caches
+    for(size_t i = free_.size(); i-- > 0;)
+    {
+      if(free_[i].first == size)
+      {
+        void* p = free_[i].second;
+        free_.erase(free_.begin() + i);
+        return p;
+      }
+    }
+  }
+  return AlignedAllocator<uint8_t>().allocate(size);
+}
+
+void ImageBufferPool::deallocate(void* p, const size_t size)
+{
+  if(size >= MIN_POOLED_SIZE)
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    free_.push_back(std::make_pair(size, p));
+    if(free_.size() <= MAX_POOLED_BUFFERS)
+    {
+      return;
+    }
+    p = free_.front().second;
+    free_.erase(free_.begin());
+  }
+  AlignedAllocator<uint8_t>().deallocate(static_cast<uint8_t*>(p), size);
+}
+
+size_t ImageBufferPool::size()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return free_.size();
+}
+
+sensor_msgs::ImagePtr full_depthimage_to_laserscan::pooled_image_geometry(const PooledImage& image)
+{
+  sensor_msgs::ImagePtr geometry = boost::make_shared<sensor_msgs::Image>();
+  geometry->header.seq = image.header.seq;
+  geometry->header.stamp = image.header.stamp;
+  geometry->header.frame_id.assign(image.header.frame_id.begin(), image.header.frame_id.end());
+  geometry->height = image.height;
+  geometry->width = image.width;
+  geometry->encoding.assign(image.encoding.begin(), image.encoding.end());
+  geometry->is_bigendian = image.is_bigendian;
+  geometry->step = image.step;
+  return geometry;
+}
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+/*
+ * Publishes a synthetic or recorded depth image stream at a fixed rate, for end-to-end benchmarking of the converter.
+ * 
+ * Every frame is stamped with the time it is published, so that latency_monitor can measure the latency from the
+ * image header stamp to the reception of the corresponding scan.
+ */
+
+#include <ros/ros.h>
+#include <image_transport/camera_common.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/image_encodings.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <boost/foreach.hpp>
+
+#include <full_depthimage_to_laserscan/depth_traits.h>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  /**
+   * A prepared frame with a header of its own: the pixels are shared with the frame instead of being copied for every
+   * message. It is serialized in the wire format of sensor_msgs/Image, so subscribers receive a normal image.
+   */
+  struct RestampedImage
+  {
+    std_msgs::Header header;
+    sensor_msgs::ImageConstPtr image;
+  };
+}
+
+namespace ros
+{
+namespace message_traits
+{
+  template<> struct MD5Sum<RestampedImage>
+  {
+    static const char* value() { return MD5Sum<sensor_msgs::Image>::value(); }
+    static const char* value(const RestampedImage&) { return value(); }
+  };
+  
+  template<> struct DataType<RestampedImage>
+  {
+    static const char* value() { return DataType<sensor_msgs::Image>::value(); }
+    static const char* value(const RestampedImage&) { return value(); }
+  };
+  
+  template<> struct Definition<RestampedImage>
+  {
+    static const char* value() { return Definition<sensor_msgs::Image>::value(); }
+    static const char* value(const RestampedImage&) { return value(); }
+  };
+  
+  template<> struct HasHeader<RestampedImage> : TrueType {};
+}
+
+namespace serialization
+{
+  template<> struct Serializer<RestampedImage>
+  {
+    template<typename Stream>
+    inline static void write(Stream& stream, const RestampedImage& m)
+    {
+      stream.next(m.header);
+      stream.next(m.image->height);
+      stream.next(m.image->width);
+      stream.next(m.image->encoding);
+      stream.next(m.image->is_bigendian);
+      stream.next(m.image->step);
+      stream.next(m.image->data);
+    }
+    
+    inline static uint32_t serializedLength(const RestampedImage& m)
+    {
+      return serializationLength(m.header) + serializationLength(m.image->height) + 
+        serializationLength(m.image->width) + serializationLength(m.image->encoding) + 
+        serializationLength(m.image->is_bigendian) + serializationLength(m.image->step) + 
+        serializationLength(m.image->data);
+    }
+  };
+}
+}
+
+namespace
+{
+  sensor_msgs::CameraInfoPtr makeCameraInfo(int width, int height)
+  {
+    // Pinhole model with the horizontal field of view of a typical structured light camera (~58 degrees)
+    double f = width / (2 * std::tan(29.0 * M_PI / 180));
+    double cx = (width - 1) / 2.0;
+    double cy = (height - 1) / 2.0;
+    
+    sensor_msgs::CameraInfoPtr info = boost::make_shared<sensor_msgs::CameraInfo>();
+    info->width = width;
+    info->height = height;
+    info->distortion_model = "plumb_bob";
+    info->D.resize(5, 0.0);
+    info->K[0] = f; info->K[2] = cx; info->K[4] = f; info->K[5] = cy; info->K[8] = 1;
+    info->R[0] = 1; info->R[4] = 1; info->R[8] = 1;
+    info->P[0] = f; info->P[2] = cx; info->P[5] = f; info->P[6] = cy; info->P[10] = 1;
+    return info;
+  }
+  
+  /**
+   * Renders a simple scene: a wall, the floor below the camera and a box in front of it, plus optional noise.
+   */
+  template <typename T>
+  sensor_msgs::ImagePtr makeImage(const sensor_msgs::CameraInfo& info, const std::string& encoding, double noise, unsigned int seed)
+  {
+    sensor_msgs::ImagePtr image = boost::make_shared<sensor_msgs::Image>();
+    image->width = info.width;
+    image->height = info.height;
+    image->encoding = encoding;
+    image->is_bigendian = false;
+    image->step = info.width * sizeof(T);
+    image->data.resize(image->step * image->height);
+    
+    const double f = info.K[0], cx = info.K[2], cy = info.K[5];
+    const double wall = 3.0, camera_height = 0.3, box = 1.2;
+    
+    T* data = reinterpret_cast<T*>(image->data.data());
+    for(unsigned int v = 0; v < info.height; ++v)
+    {
+      for(unsigned int u = 0; u < info.width; ++u)
+      {
+        double depth = wall;
+        if(v > cy)
+        {
+          depth = std::min(depth, camera_height * f / (v - cy)); // floor
+        }
+        if(std::fabs(u - cx) < info.width / 10.0 && v > cy - info.height / 8.0)
+        {
+          depth = std::min(depth, box);
+        }
+        depth += noise * ((double)rand_r(&seed) / RAND_MAX - 0.5);
+        data[v * info.width + u] = DepthTraits<T>::fromMeters(depth);
+      }
+    }
+    return image;
+  }
+}
+
+int main(int argc, char **argv){
+  ros::init(argc, argv, "replay_publisher");
+  ros::NodeHandle n;
+  ros::NodeHandle pnh("~");
+  
+  int width = 640, height = 480, num_frames = 1000, num_variants = 16;
+  double rate = 30, noise = 0.01, start_delay = 2.0;
+  std::string encoding = sensor_msgs::image_encodings::TYPE_16UC1, bag_file;
+  pnh.getParam("width", width);
+  pnh.getParam("height", height);
+  pnh.getParam("rate", rate);
+  pnh.getParam("num_frames", num_frames);
+  pnh.getParam("encoding", encoding);
+  pnh.getParam("noise", noise);
+  pnh.getParam("start_delay", start_delay);
+  pnh.getParam("bag", bag_file);
+  
+  // Frames are prepared up front so that publishing them costs no more than publishing live camera data
+  std::vector<sensor_msgs::ImagePtr> images;
+  std::vector<sensor_msgs::CameraInfoPtr> infos;
+  
+  if(!bag_file.empty())
+  {
+    std::string image_topic = "image", info_topic = "camera_info";
+    pnh.getParam("bag_image_topic", image_topic);
+    pnh.getParam("bag_info_topic", info_topic);
+    
+    rosbag::Bag bag(bag_file, rosbag::bagmode::Read);
+    rosbag::View view(bag, rosbag::TopicQuery(std::vector<std::string>{image_topic, info_topic}));
+    sensor_msgs::CameraInfoPtr info;
+    BOOST_FOREACH(const rosbag::MessageInstance& m, view)
+    {
+      sensor_msgs::CameraInfoPtr new_info = m.instantiate<sensor_msgs::CameraInfo>();
+      if(new_info)
+      {
+        info = new_info;
+      }
+      sensor_msgs::ImagePtr image = m.instantiate<sensor_msgs::Image>();
+      if(image && info)
+      {
+        images.push_back(image);
+        infos.push_back(info);
+      }
+    }
+    if(images.empty())
+    {
+      ROS_FATAL_STREAM("No image/camera_info pairs found in " << bag_file);
+      return 1;
+    }
+    ROS_INFO_STREAM("Loaded " << images.size() << " frames from " << bag_file);
+  }
+  else
+  {
+    sensor_msgs::CameraInfoPtr info = makeCameraInfo(width, height);
+    for(int i = 0; i < num_variants; ++i)
+    {
+      if(encoding == sensor_msgs::image_encodings::TYPE_16UC1)
+      {
+        images.push_back(makeImage<uint16_t>(*info, encoding, noise, i + 1));
+      }
+      else if(encoding == sensor_msgs::image_encodings::TYPE_32FC1)
+      {
+        images.push_back(makeImage<float>(*info, encoding, noise, i + 1));
+      }
+      else
+      {
+        ROS_FATAL_STREAM("Unsupported encoding: " << encoding);
+        return 1;
+      }
+      infos.push_back(info);
+    }
+  }
+  
+  // Published without image_transport so that the prepared pixels can be shared; this is the raw transport's topic pair
+  const std::string image_topic = n.resolveName("image");
+  ros::Publisher image_pub = n.advertise<RestampedImage>(image_topic, 10);
+  ros::Publisher info_pub = n.advertise<sensor_msgs::CameraInfo>(image_transport::getCameraInfoTopic(image_topic), 10);
+  
+  // Give the converter and the monitor time to connect
+  ros::Duration(start_delay).sleep();
+  
+  ros::Rate loop(rate);
+  for(int i = 0; i < num_frames && ros::ok(); ++i)
+  {
+    // Fresh headers so that queued messages are never modified; the pixels are shared with the prepared frame
+    boost::shared_ptr<RestampedImage> image = boost::make_shared<RestampedImage>();
+    image->image = images[i % images.size()];
+    sensor_msgs::CameraInfoPtr info = boost::make_shared<sensor_msgs::CameraInfo>(*infos[i % infos.size()]);
+    image->header.seq = i;
+    image->header.stamp = ros::Time::now();
+    image->header.frame_id = "camera_depth_optical_frame";
+    info->header = image->header;
+    
+    image_pub.publish(image);
+    info_pub.publish(info);
+    ros::spinOnce();
+    loop.sleep();
+  }
+  
+  ROS_INFO_STREAM("Published " << num_frames << " frames");
+  return 0;
+}
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+#include <full_depthimage_to_laserscan/scan_shm.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+using namespace full_depthimage_to_laserscan;
+
+#if ATOMIC_INT_LOCK_FREE != 2 || ATOMIC_LLONG_LOCK_FREE != 2
+#error "The shared-memory ring requires lock-free 32 and 64 bit atomics"
+#endif
+
+namespace
+{
+  const size_t CACHE_LINE = 64;
+  const int MAX_READ_ATTEMPTS = 64; ///< Retries of a torn read before giving up on a slot
+
+  /**
+   * Beginning of each slot; the ranges follow at RANGES_OFFSET.
+   */
+  struct ShmSlot
+  {
+    std::atomic<uint64_t> sequence; ///< Seqlock: odd while the slot is being written
+    ShmScanInfo info;
+  };
+
+  const size_t HEADER_SIZE = (sizeof(ShmRingHeader) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+  const size_t RANGES_OFFSET = (sizeof(ShmSlot) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+
+  size_t slot_size(const uint32_t max_beams)
+  {
+    return (RANGES_OFFSET + max_beams*sizeof(float) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+  }
+
+  size_t ring_size(const uint32_t num_slots, const uint32_t max_beams)
+  {
+    return HEADER_SIZE + num_slots*slot_size(max_beams);
+  }
+
+  void throw_errno(const std::string& what, const std::string& name)
+  {
+    throw std::runtime_error(what + " " + name + ": " + strerror(errno));
+  }
+
+  /**
+   * Returns true if the mapped header describes a complete ring of the given size.
+   */
+  bool valid_header(const ShmRingHeader* header, const size_t size)
+  {
+    return size >= HEADER_SIZE && memcmp(header->magic, SCAN_SHM_MAGIC, sizeof(header->magic)) == 0 &&
+      header->version == SCAN_SHM_VERSION && header->num_slots > 0 &&
+      header->slot_size == slot_size(header->max_beams) && size == ring_size(header->num_slots, header->max_beams);
+  }
+}
+
+ScanShmWriter::ScanShmWriter():
+  map_(NULL), size_(0), header_(NULL)
+{
+}
+
+ScanShmWriter::~ScanShmWriter()
+{
+  close();
+}
+
+void ScanShmWriter::open(const std::string& name, const uint32_t num_slots, const uint32_t max_beams)
+{
+  close();
+
+  const uint32_t slots = std::max(num_slots, 2u);
+  const size_t size = ring_size(slots, max_beams);
+
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+  if(fd < 0)
+  {
+    throw_errno("Failed to open shared memory", name);
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0)
+  {
+    ::close(fd);
+    throw_errno("Failed to stat shared memory", name);
+  }
+
+  bool reuse = false;
+  if((size_t)st.st_size == size)
+  {
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map != MAP_FAILED)
+    {
+      ShmRingHeader* header = static_cast<ShmRingHeader*>(map);
+      reuse = valid_header(header, size) && header->num_slots == slots && header->max_beams == max_beams;
+      if(reuse)
+      {
+        map_ = static_cast<uint8_t*>(map);
+      }
+      else
+      {
+        munmap(map, size);
+      }
+    }
+  }
+
+  if(!reuse)
+  {
+    // Readers may have the old object mapped, so it is never resized: mark it closed and replace it
+    if((size_t)st.st_size >= HEADER_SIZE)
+    {
+      void* map = mmap(NULL, HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if(map != MAP_FAILED)
+      {
+        static_cast<ShmRingHeader*>(map)->closed.store(1, std::memory_order_release);
+        munmap(map, HEADER_SIZE);
+      }
+    }
+    ::close(fd);
+    shm_unlink(name.c_str());
+
+    fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if(fd < 0)
+    {
+      throw_errno("Failed to create shared memory", name);
+    }
+    if(ftruncate(fd, size) != 0)
+    {
+      ::close(fd);
+      throw_errno("Failed to size shared memory", name);
+    }
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(map == MAP_FAILED)
+    {
+      ::close(fd);
+      throw_errno("Failed to map shared memory", name);
+    }
+    map_ = static_cast<uint8_t*>(map);
+
+    // The object is zero-filled, so all slots start out even (not being written) and empty
+    ShmRingHeader* header = reinterpret_cast<ShmRingHeader*>(map_);
+    header->version = SCAN_SHM_VERSION;
+    header->num_slots = slots;
+    header->max_beams = max_beams;
+    header->slot_size = slot_size(max_beams);
+    header->closed.store(0, std::memory_order_relaxed);
+    header->written.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, SCAN_SHM_MAGIC, sizeof(header->magic));
+  }
+  ::close(fd); // The mapping keeps the object
+
+  name_ = name;
+  size_ = size;
+  header_ = reinterpret_cast<ShmRingHeader*>(map_);
+  header_->closed.store(0, std::memory_order_release);
+}
+
+bool ScanShmWriter::is_open() const
+{
+  return map_ != NULL;
+}
+
+uint32_t ScanShmWriter::max_beams() const
+{
+  return header_ ? header_->max_beams : 0;
+}
+
+void ScanShmWriter::write(const ShmScanInfo& info, const float* ranges, const uint32_t num_beams)
+{
+  if(!map_)
+  {
+    return;
+  }
+
+  const uint64_t index = header_->written.load(std::memory_order_relaxed);
+  ShmSlot* slot = reinterpret_cast<ShmSlot*>(map_ + HEADER_SIZE + (index % header_->num_slots)*header_->slot_size);
+  float* slot_ranges = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(slot) + RANGES_OFFSET);
+
+  // A writer that died mid-write on a reused ring leaves the sequence odd; keep it odd rather than making it even
+  const uint64_t sequence = slot->sequence.load(std::memory_order_relaxed) | 1;
+  slot->sequence.store(sequence, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release); // The odd sequence is visible before any of the data
+
+  slot->info = info;
+  slot->info.index = index;
+  slot->info.num_beams = std::min(num_beams, header_->max_beams);
+  memcpy(slot_ranges, ranges, slot->info.num_beams*sizeof(float));
+
+  slot->sequence.store(sequence + 1, std::memory_order_release);
+  header_->written.store(index + 1, std::memory_order_release);
+}
+
+void ScanShmWriter::close()
+{
+  if(map_)
+  {
+    header_->closed.store(1, std::memory_order_release);
+    munmap(map_, size_);
+  }
+  map_ = NULL;
+  header_ = NULL;
+  size_ = 0;
+}
+
+ScanShmReader::ScanShmReader():
+  map_(NULL), size_(0), header_(NULL)
+{
+}
+
+ScanShmReader::~ScanShmReader()
+{
+  close();
+}
+
+void ScanShmReader::open(const std::string& name)
+{
+  close();
+
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if(fd < 0)
+  {
+    throw_errno("Failed to open shared memory", name);
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0)
+  {
+    ::close(fd);
+    throw_errno("Failed to stat shared memory", name);
+  }
+  if((size_t)st.st_size < HEADER_SIZE)
+  {
+    ::close(fd);
+    throw std::runtime_error("Shared memory " + name + " is not a scan ring (yet)");
+  }
+
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if(map == MAP_FAILED)
+  {
+    throw_errno("Failed to map shared memory", name);
+  }
+
+  const ShmRingHeader* header = static_cast<const ShmRingHeader*>(map);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(!valid_header(header, st.st_size))
+  {
+    munmap(map, st.st_size);
+    throw std::runtime_error("Shared memory " + name + " is not a scan ring (yet)");
+  }
+
+  map_ = static_cast<const uint8_t*>(map);
+  size_ = st.st_size;
+  header_ = header;
+}
+
+void ScanShmReader::close()
+{
+  if(map_)
+  {
+    munmap(const_cast<uint8_t*>(map_), size_);
+  }
+  map_ = NULL;
+  header_ = NULL;
+  size_ = 0;
+}
+
+bool ScanShmReader::is_open() const
+{
+  return map_ != NULL;
+}
+
+bool ScanShmReader::closed() const
+{
+  return !header_ || header_->closed.load(std::memory_order_acquire) != 0;
+}
+
+uint64_t ScanShmReader::written() const
+{
+  return header_ ? header_->written.load(std::memory_order_acquire) : 0;
+}
+
+bool ScanShmReader::read_latest(ShmScanInfo& info, std::vector<float>& ranges) const
+{
+  for(int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+  {
+    const uint64_t written = this->written();
+    if(written == 0)
+    {
+      return false;
+    }
+    if(read(written - 1, info, ranges))
+    {
+      return true;
+    }
+    // The writer lapped the ring while the scan was being copied; try the new latest one
+  }
+  return false;
+}
+
+bool ScanShmReader::read(const uint64_t index, ShmScanInfo& info, std::vector<float>& ranges) const
+{
+  if(!header_ || index >= written())
+  {
+    return false;
+  }
+
+  const ShmSlot* slot = reinterpret_cast<const ShmSlot*>(map_ + HEADER_SIZE +
+                                                          (index % header_->num_slots)*header_->slot_size);
+  const float* slot_ranges = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(slot) + RANGES_OFFSET);
+  ranges.reserve(header_->max_beams);
+
+  for(int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+  {
+    const uint64_t before = slot->sequence.load(std::memory_order_acquire);
+    if(before & 1)
+    {
+      continue; // Being written
+    }
+
+    memcpy(&info, &slot->info, sizeof(info));
+    const uint32_t num_beams = std::min(info.num_beams, header_->max_beams);
+    ranges.resize(num_beams);
+    memcpy(ranges.data(), slot_ranges, num_beams*sizeof(float));
+
+    std::atomic_thread_fence(std::memory_order_acquire); // The copies complete before the sequence is checked again
+    if(slot->sequence.load(std::memory_order_relaxed) == before)
+    {
+      return info.index == index; // Otherwise the slot already holds a newer scan
+    }
+  }
+  return false;
+}
@@ -0,0 +1,1059 @@
+/*
+ * Copyright (c) 2026, agent
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the copyright holder nor the names of its
+ *       contributors may be used to endorse or promote products derived from
+ *       this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* 
+ * Author: agent
+ */
+
+// Checks the conversion options, kernels and input paths against equivalent conversions of synthetic frames, and
+// the compact and shared-memory scan outputs
+#include <full_depthimage_to_laserscan/DepthImageToLaserScan.h>
+#include <full_depthimage_to_laserscan/cloud_input.h>
+#include <full_depthimage_to_laserscan/compact_scan.h>
+#include <full_depthimage_to_laserscan/image_rotation.h>
+#include <full_depthimage_to_laserscan/pooled_image.h>
+#include <full_depthimage_to_laserscan/scan_shm.h>
+#include <ros/serialization.h>
+#include <gtest/gtest.h>
+#include <boost/thread/thread.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace full_depthimage_to_laserscan;
+
+namespace
+{
+  const int WIDTH = 640;
+  const int HEIGHT = 480;
+  const float RANGE_MIN = 0.45;
+  const float RANGE_MAX = 10.0;
+  const float FLOOR_DIST = 0.25;
+  const float OVERHEAD_DIST = 0.15;
+  
+  sensor_msgs::CameraInfoPtr make_camera_info()
+  {
+    sensor_msgs::CameraInfoPtr info(new sensor_msgs::CameraInfo);
+    info->header.frame_id = "camera_depth_optical_frame";
+    info->width = WIDTH;
+    info->height = HEIGHT;
+    info->distortion_model = "plumb_bob";
+    info->D.resize(5); // All 0, no distortion
+    info->K[0] = info->K[4] = info->P[0] = info->P[5] = 570.3422241210938;
+    info->K[2] = info->P[2] = 319.5;
+    info->K[5] = info->P[6] = 239.5;
+    info->K[8] = info->P[10] = 1.0;
+    info->R[0] = info->R[4] = info->R[8] = 1.0;
+    return info;
+  }
+  
+  /**
+   * Depth in meters of pixel (u, v) of the synthetic scene: a slanted wall with a few boxes in front of it, speckle,
+   * holes and pixels nearer than range_min, all deterministic.
+   */
+  float scene_depth(const int u, const int v)
+  {
+    unsigned int hash = (u*73856093u) ^ (v*19349663u);
+    hash = (hash ^ (hash >> 13)) * 1274126177u;
+    if(hash % 29 == 0)
+    {
+      return 0; // Hole
+    }
+    float depth = 2.0 + 2.5*u/WIDTH;
+    if(u > 100 && u < 180 && v > 200 && v < 300)
+    {
+      depth = 1.2;
+    }
+    if(u > 400 && u < 430)
+    {
+      depth = 0.8 + 0.002*v; // Pole leaning towards the camera
+    }
+    if(hash % 31 == 0)
+    {
+      depth = 0.3; // Too near
+    }
+    return depth + 0.001*(hash % 17);
+  }
+  
+  /**
+   * Depth in meters of pixel (u, v) of a noisy scene without holes or pixels nearer than range_min: uniform depths
+   * between 1 and 3 meters, with one pixel in 13 a speckle at 0.6 meters.
+   */
+  float speckle_depth(const int u, const int v)
+  {
+    unsigned int hash = (u*73856093u) ^ (v*19349663u);
+    hash = (hash ^ (hash >> 13)) * 1274126177u;
+    if(hash % 13 == 0)
+    {
+      return 0.6;
+    }
+    return 1.0 + 0.002*(hash % 1000);
+  }
+  
+  template<typename T>
+  sensor_msgs::ImagePtr make_depth_image(float (*depth_of)(int, int) = scene_depth)
+  {
+    sensor_msgs::ImagePtr image(new sensor_msgs::Image);
+    image->header.frame_id = "camera_depth_optical_frame";
+    image->width = WIDTH;
+    image->height = HEIGHT;
+    image->encoding = boost::is_same<T, float>::value ? sensor_msgs::image_encodings::TYPE_32FC1 : 
+                                                        sensor_msgs::image_encodings::TYPE_16UC1;
+    image->step = WIDTH*sizeof(T);
+    image->data.resize(image->step*HEIGHT);
+    T* pixels = reinterpret_cast<T*>(image->data.data());
+    for(int v = 0; v < HEIGHT; ++v)
+    {
+      for(int u = 0; u < WIDTH; ++u)
+      {
+        const float depth = depth_of(u, v);
+        pixels[v*WIDTH + u] = (depth > 0) ? DepthTraits<T>::fromMeters(depth) : T(0);
+      }
+    }
+    return image;
+  }
+  
+  /**
+   * Organized cloud of the float image, with point_step floats per point (x, y, z, then padding).
+   */
+  sensor_msgs::PointCloud2Ptr make_cloud(const sensor_msgs::Image& image, const sensor_msgs::CameraInfo& info, 
+                                         const int point_step)
+  {
+    sensor_msgs::PointCloud2Ptr cloud(new sensor_msgs::PointCloud2);
+    cloud->header = image.header;
+    cloud->width = image.width;
+    cloud->height = image.height;
+    const char* names[3] = {"x", "y", "z"};
+    for(int i = 0; i < 3; ++i)
+    {
+      sensor_msgs::PointField field;
+      field.name = names[i];
+      field.offset = i*sizeof(float);
+      field.datatype = sensor_msgs::PointField::FLOAT32;
+      field.count = 1;
+      cloud->fields.push_back(field);
+    }
+    cloud->point_step = point_step*sizeof(float);
+    cloud->row_step = cloud->point_step*cloud->width;
+    cloud->data.assign(cloud->row_step*cloud->height, 0);
+    
+    const float* depths = reinterpret_cast<const float*>(image.data.data());
+    float* points = reinterpret_cast<float*>(cloud->data.data());
+    for(int v = 0; v < (int)image.height; ++v)
+    {
+      for(int u = 0; u < (int)image.width; ++u)
+      {
+        const float z = depths[v*image.width + u];
+        float* point = points + (v*image.width + u)*point_step;
+        if(z > 0)
+        {
+          point[0] = (u - info.K[2])*z/info.K[0];
+          point[1] = (v - info.K[5])*z/info.K[4];
+          point[2] = z;
+        }
+        else
+        {
+          point[0] = point[1] = point[2] = std::numeric_limits<float>::quiet_NaN();
+        }
+      }
+    }
+    return cloud;
+  }
+  
+  void setup(DepthImageToLaserScan& dtl, const int scan_height, const int row_stride)
+  {
+    dtl.set_scan_time(1.0/30.0);
+    dtl.set_range_limits(RANGE_MIN, RANGE_MAX);
+    dtl.set_scan_height(scan_height);
+    dtl.set_row_stride(row_stride);
+    dtl.set_output_frame("camera_depth_frame");
+    dtl.set_filtering_limits(FLOOR_DIST, OVERHEAD_DIST);
+  }
+  
+  sensor_msgs::LaserScanPtr convert(const sensor_msgs::ImageConstPtr& image, const int approach, 
+                                    const int scan_height, const int row_stride, const bool quantize = false)
+  {
+    DepthImageToLaserScan dtl;
+    setup(dtl, scan_height, row_stride);
+    dtl.set_quantize(quantize);
+    sensor_msgs::ImageConstPtr limits;
+    return dtl.convert_msg(image, make_camera_info(), approach, limits);
+  }
+  
+  /**
+   * Expects identical ranges; NaN (no return) only matches NaN.
+   */
+  void expect_same_ranges(const sensor_msgs::LaserScan& expected, const sensor_msgs::LaserScan& actual)
+  {
+    ASSERT_EQ(expected.ranges.size(), actual.ranges.size());
+    int mismatches = 0;
+    for(size_t i = 0; i < expected.ranges.size(); ++i)
+    {
+      const float a = expected.ranges[i], b = actual.ranges[i];
+      if(!(a == b || (std::isnan(a) && std::isnan(b))))
+      {
+        ++mismatches;
+      }
+    }
+    EXPECT_EQ(0, mismatches);
+  }
+  
+  /**
+   * Returns the number of beams with a return, so that scans without any can't agree trivially.
+   */
+  int count_returns(const sensor_msgs::LaserScan& scan)
+  {
+    int returns = 0;
+    for(size_t i = 0; i < scan.ranges.size(); ++i)
+    {
+      returns += std::isfinite(scan.ranges[i]);
+    }
+    return returns;
+  }
+  
+  template<typename T>
+  void expect_kernels_agree()
+  {
+    sensor_msgs::ImagePtr image = make_depth_image<T>();
+    const int scan_heights[] = {1, 7, 100, HEIGHT - 1};
+    for(int h = 0; h < 4; ++h)
+    {
+      for(int row_stride = 1; row_stride <= 2; ++row_stride)
+      {
+        SCOPED_TRACE(::testing::Message() << "scan_height " << scan_heights[h] << ", row_stride " << row_stride);
+        sensor_msgs::LaserScanPtr halving = convert(image, DepthImageToLaserScan::KERNEL_HALVING, scan_heights[h], 
+                                                    row_stride);
+        EXPECT_GT(count_returns(*halving), WIDTH/2);
+        expect_same_ranges(*halving, *convert(image, DepthImageToLaserScan::KERNEL_FUSED, scan_heights[h], row_stride));
+        expect_same_ranges(*halving, *convert(image, DepthImageToLaserScan::KERNEL_THREADED, scan_heights[h], 
+                                              row_stride));
+      }
+    }
+  }
+  
+  /**
+   * Expects the scan of the speckled scene with min_support k to equal the plain scan of an image whose columns hold
+   * the depth each column should report: the k-th smallest depth of the band, or the smallest if the k smallest lie
+   * within the tolerance of it.
+   */
+  template<typename T>
+  void expect_support_matches_columns(const int k)
+  {
+    const int scan_height = 7;
+    const float tolerance = 0.01;
+    const int offset = (int)(make_camera_info()->K[5] - scan_height/2);
+    sensor_msgs::ImagePtr image = make_depth_image<T>(speckle_depth);
+    sensor_msgs::ImagePtr columns = make_depth_image<T>(speckle_depth);
+    const T* pixels = reinterpret_cast<const T*>(image->data.data());
+    T* column_pixels = reinterpret_cast<T*>(columns->data.data());
+    for(int u = 0; u < WIDTH; ++u)
+    {
+      std::vector<T> band;
+      for(int v = offset; v < offset + scan_height; ++v)
+      {
+        band.push_back(pixels[v*WIDTH + u]);
+      }
+      std::sort(band.begin(), band.end());
+      const T depth = (band[k-1] - band[0] <= DepthTraits<T>::fromMeters(tolerance)) ? band[0] : band[k-1];
+      for(int v = 0; v < HEIGHT; ++v)
+      {
+        column_pixels[v*WIDTH + u] = depth;
+      }
+    }
+    
+    DepthImageToLaserScan supported;
+    setup(supported, scan_height, 1);
+    supported.set_speckle_filter(k, tolerance);
+    sensor_msgs::ImageConstPtr limits;
+    sensor_msgs::LaserScanPtr scan = supported.convert_msg(image, make_camera_info(), 
+                                                           DepthImageToLaserScan::KERNEL_HALVING, limits);
+    sensor_msgs::LaserScanPtr expected = convert(columns, DepthImageToLaserScan::KERNEL_HALVING, scan_height, 1);
+    EXPECT_GT(count_returns(*expected), WIDTH/2);
+    expect_same_ranges(*expected, *scan);
+  }
+  
+  /**
+   * Expects the incremental conversion of a sequence of frames, in which a patch of the scene moves nearer each frame,
+   * to give the scans of the full conversion. The patches span INCREMENTAL_SAMPLE_INTERVAL rows, so that every change
+   * is among the rows sampled in the frame it happens.
+   */
+  template<typename T>
+  void expect_incremental_matches_full()
+  {
+    const int scan_height = 100;
+    const int offset = (int)(make_camera_info()->K[5] - scan_height/2);
+    DepthImageToLaserScan full, incremental;
+    setup(full, scan_height, 1);
+    setup(incremental, scan_height, 1);
+    incremental.set_incremental(true, 0, 10);
+    
+    sensor_msgs::ImagePtr image = make_depth_image<T>();
+    T* pixels = reinterpret_cast<T*>(image->data.data());
+    sensor_msgs::ImageConstPtr limits;
+    for(int frame = 0; frame < 25; ++frame)
+    {
+      SCOPED_TRACE(::testing::Message() << "frame " << frame);
+      if(frame > 0)
+      {
+        const int u_begin = (frame*97) % (WIDTH - 40);
+        const int v_begin = offset + (frame*31) % (scan_height - DepthImageToLaserScan::INCREMENTAL_SAMPLE_INTERVAL);
+        for(int v = v_begin; v < v_begin + DepthImageToLaserScan::INCREMENTAL_SAMPLE_INTERVAL; ++v)
+        {
+          for(int u = u_begin; u < u_begin + 40; ++u)
+          {
+            pixels[v*WIDTH + u] = DepthTraits<T>::fromMeters(0.6 + 0.05*(frame % 7));
+          }
+        }
+      }
+      sensor_msgs::LaserScanPtr expected = full.convert_msg(image, make_camera_info(), 
+                                                            DepthImageToLaserScan::KERNEL_FUSED, limits);
+      EXPECT_GT(count_returns(*expected), WIDTH/2);
+      expect_same_ranges(*expected, *incremental.convert_msg(image, make_camera_info(), 
+                                                             DepthImageToLaserScan::KERNEL_FUSED, limits));
+    }
+  }
+  
+  /**
+   * Returns true if the point lies inside the polygon (even-odd rule).
+   */
+  bool inside_polygon(const Polygon& polygon, const double x, const double y)
+  {
+    bool inside = false;
+    for(size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+    {
+      const cv::Point2d& a = polygon[i];
+      const cv::Point2d& b = polygon[j];
+      if((a.y > y) != (b.y > y) && x < (b.x - a.x)*(y - a.y)/(b.y - a.y) + a.x)
+      {
+        inside = !inside;
+      }
+    }
+    return inside;
+  }
+  
+  /**
+   * Returns the first zone holding at least min_beams returns of the scan, or -1.
+   */
+  int violated_zone(const sensor_msgs::LaserScan& scan, const std::vector<Polygon>& zones, 
+                    const int min_beams)
+  {
+    for(size_t z = 0; z < zones.size(); ++z)
+    {
+      int beams = 0;
+      for(size_t i = 0; i < scan.ranges.size(); ++i)
+      {
+        const double angle = scan.angle_min + i*scan.angle_increment;
+        const double range = scan.ranges[i];
+        beams += std::isfinite(range) && inside_polygon(zones[z], range*std::cos(angle), range*std::sin(angle));
+      }
+      if(beams >= min_beams)
+      {
+        return z;
+      }
+    }
+    return -1;
+  }
+  
+  /**
+   * Expects the safety check of every kernel to report the zone that the returns of its scan violate, for a far
+   * wall and for a box in the far zone, in the near zone and at the side of the far zone.
+   */
+  template<typename T>
+  void expect_safety_matches_scan()
+  {
+    const int min_columns = 3;
+    std::vector<Polygon> zones(2);
+    zones[0].push_back(cv::Point2d(0, -0.3));
+    zones[0].push_back(cv::Point2d(0.8, -0.3));
+    zones[0].push_back(cv::Point2d(0.8, 0.3));
+    zones[0].push_back(cv::Point2d(0, 0.3));
+    zones[1].push_back(cv::Point2d(0, -0.6));
+    zones[1].push_back(cv::Point2d(1.8, -0.6));
+    zones[1].push_back(cv::Point2d(1.8, 0.6));
+    zones[1].push_back(cv::Point2d(0, 0.6));
+    
+    // Box depth, first column and expected zone of each scene; a depth of 0 leaves the wall alone
+    const float box_depths[] = {0, 1.5, 0.7, 1.0};
+    const int box_columns[] = {0, 300, 300, 10};
+    const int expected_zones[] = {-1, 1, 0, 1};
+    for(int scene = 0; scene < 4; ++scene)
+    {
+      sensor_msgs::ImagePtr image = make_depth_image<T>();
+      T* pixels = reinterpret_cast<T*>(image->data.data());
+      for(int v = 0; v < HEIGHT; ++v)
+      {
+        for(int u = 0; u < WIDTH; ++u)
+        {
+          const bool box = box_depths[scene] > 0 && v >= 200 && v < 260 && 
+                           u >= box_columns[scene] && u < box_columns[scene] + 40;
+          pixels[v*WIDTH + u] = DepthTraits<T>::fromMeters(box ? box_depths[scene] : 3.0);
+        }
+      }
+      
+      for(int approach = DepthImageToLaserScan::KERNEL_REFERENCE; approach <= DepthImageToLaserScan::KERNEL_THREADED; 
+          ++approach)
+      {
+        SCOPED_TRACE(::testing::Message() << "scene " << scene << ", kernel " 
+                                          << DepthImageToLaserScan::kernel_name(approach));
+        DepthImageToLaserScan dtl;
+        setup(dtl, 100, 1);
+        dtl.set_safety_zones(zones, min_columns);
+        int reported = -2;
+        dtl.set_safety_callback([&](const int zone) { reported = zone; });
+        sensor_msgs::ImageConstPtr limits;
+        sensor_msgs::LaserScanPtr scan = dtl.convert_msg(image, make_camera_info(), approach, limits);
+        EXPECT_EQ(expected_zones[scene], violated_zone(*scan, zones, min_columns));
+        EXPECT_EQ(violated_zone(*scan, zones, min_columns), reported);
+      }
+    }
+  }
+  
+  /**
+   * Expects the scan of a camera mounted rotated to equal the scan of the upright camera, for every rotation, kernel
+   * and min_support 1 and 3. The mounted image is the upright one turned back by the rotation, and the principal point
+   * is off center and the focal lengths differ, so that a mixed up axis changes the scan.
+   */
+  template<typename T>
+  void expect_rotation_matches_upright()
+  {
+    sensor_msgs::CameraInfoPtr upright_info = make_camera_info();
+    upright_info->K[2] = upright_info->P[2] = 300.3;
+    upright_info->K[5] = upright_info->P[6] = 250.7;
+    upright_info->K[4] = upright_info->P[5] = 560.0;
+    sensor_msgs::ImagePtr upright = make_depth_image<T>();
+    
+    const int rotations[] = {0, 90, 180, 270};
+    for(int r = 0; r < 4; ++r)
+    {
+      const int back = (360 - rotations[r]) % 360;
+      RotatedView<T> view = rotated_view<T>(*upright, back);
+      sensor_msgs::ImagePtr mounted(new sensor_msgs::Image(*upright));
+      mounted->width = view.width;
+      mounted->height = view.height;
+      mounted->step = view.width*sizeof(T);
+      T* pixels = reinterpret_cast<T*>(mounted->data.data());
+      for(int v = 0; v < view.height; ++v)
+      {
+        for(int u = 0; u < view.width; ++u)
+        {
+          pixels[v*view.width + u] = view(u, v);
+        }
+      }
+      sensor_msgs::CameraInfoPtr mounted_info = rotate_camera_info(*upright_info, back);
+      
+      for(int approach = DepthImageToLaserScan::KERNEL_HALVING; approach <= DepthImageToLaserScan::KERNEL_THREADED; 
+          ++approach)
+      {
+        for(int min_support = 1; min_support <= 3; min_support += 2)
+        {
+          SCOPED_TRACE(::testing::Message() << "rotation " << rotations[r] << ", kernel " 
+                                            << DepthImageToLaserScan::kernel_name(approach) << ", min_support " 
+                                            << min_support);
+          DepthImageToLaserScan expected_dtl, rotated_dtl;
+          setup(expected_dtl, 60, 1);
+          setup(rotated_dtl, 60, 1);
+          expected_dtl.set_speckle_filter(min_support, 0.02);
+          rotated_dtl.set_speckle_filter(min_support, 0.02);
+          rotated_dtl.set_rotation(rotations[r]);
+          sensor_msgs::ImageConstPtr limits;
+          sensor_msgs::LaserScanPtr expected = expected_dtl.convert_msg(upright, upright_info, approach, limits);
+          sensor_msgs::LaserScanPtr scan = rotated_dtl.convert_msg(mounted, mounted_info, approach, limits);
+          EXPECT_GT(count_returns(*expected), WIDTH/2);
+          EXPECT_FLOAT_EQ(expected->angle_min, scan->angle_min);
+          EXPECT_FLOAT_EQ(expected->angle_increment, scan->angle_increment);
+          expect_same_ranges(*expected, *scan);
+        }
+      }
+    }
+  }
+  
+  /**
+   * Deserializes a message from its wire format, as roscpp does for a subscriber of type M.
+   */
+  template<typename M>
+  boost::shared_ptr<M> deserialize(std::vector<uint8_t>& wire)
+  {
+    boost::shared_ptr<M> message(new M);
+    ros::serialization::IStream stream(wire.data(), wire.size());
+    ros::serialization::deserialize(stream, *message);
+    return message;
+  }
+  
+  /**
+   * Expects a stream of frames deserialized into pooled buffers to hold the same images as the plain sensor_msgs::Image
+   * path and to give the same scans, including once the buffers are reused for later frames with other content.
+   */
+  template<typename T>
+  void expect_pooled_matches_plain()
+  {
+    DepthImageToLaserScan plain_dtl, pooled_dtl;
+    setup(plain_dtl, 100, 1);
+    setup(pooled_dtl, 100, 1);
+    sensor_msgs::ImagePtr image = make_depth_image<T>();
+    image->header.seq = 7;
+    image->header.stamp = ros::Time(12, 345);
+    T* pixels = reinterpret_cast<T*>(image->data.data());
+    for(int frame = 0; frame < 4; ++frame)
+    {
+      SCOPED_TRACE(::testing::Message() << "frame " << frame);
+      for(int v = 200; v < 280; ++v)
+      {
+        for(int u = frame*80; u < frame*80 + 80; ++u)
+        {
+          pixels[v*WIDTH + u] = DepthTraits<T>::fromMeters(1.0 + 0.25*frame);
+        }
+      }
+      std::vector<uint8_t> wire(ros::serialization::serializationLength(*image));
+      ros::serialization::OStream stream(wire.data(), wire.size());
+      ros::serialization::serialize(stream, *image);
+      
+      sensor_msgs::ImageConstPtr plain = deserialize<sensor_msgs::Image>(wire);
+      PooledImageConstPtr pooled = deserialize<PooledImage>(wire);
+      EXPECT_EQ(plain->header.seq, pooled->header.seq);
+      EXPECT_EQ(plain->header.stamp, pooled->header.stamp);
+      EXPECT_EQ(plain->header.frame_id, std::string(pooled->header.frame_id.begin(), pooled->header.frame_id.end()));
+      EXPECT_EQ(plain->encoding, std::string(pooled->encoding.begin(), pooled->encoding.end()));
+      EXPECT_EQ(plain->width, pooled->width);
+      EXPECT_EQ(plain->height, pooled->height);
+      EXPECT_EQ(plain->step, pooled->step);
+      ASSERT_EQ(plain->data.size(), pooled->data.size());
+      EXPECT_TRUE(std::equal(plain->data.begin(), plain->data.end(), pooled->data.begin()));
+      EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(pooled->data.data()) % 64);
+      
+      sensor_msgs::ImageConstPtr limits;
+      sensor_msgs::LaserScanPtr expected = plain_dtl.convert_msg(plain, make_camera_info(), 
+                                                                 DepthImageToLaserScan::KERNEL_FUSED, limits);
+      sensor_msgs::LaserScanPtr scan = pooled_dtl.convert_buffer(pooled_image_geometry(*pooled), pooled->data.data(), 
+                                                                 make_camera_info(), 
+                                                                 DepthImageToLaserScan::KERNEL_FUSED, limits, pooled);
+      EXPECT_GT(count_returns(*expected), WIDTH/2);
+      EXPECT_EQ(expected->header.frame_id, scan->header.frame_id);
+      EXPECT_EQ(expected->header.stamp, scan->header.stamp);
+      expect_same_ranges(*expected, *scan);
+    }
+    EXPECT_GT(ImageBufferPool::instance().size(), 0u); // The buffers of the released frames
+  }
+}
+
+// Each column reports its min_support-th smallest depth, unless the nearer ones support the nearest
+TEST(KernelTest, uint16SupportedMatchesColumns)
+{
+  for(int k = 1; k <= 3; ++k)
+  {
+    SCOPED_TRACE(::testing::Message() << "min_support " << k);
+    expect_support_matches_columns<uint16_t>(k);
+  }
+}
+
+TEST(KernelTest, floatSupportedMatchesColumns)
+{
+  for(int k = 1; k <= 3; ++k)
+  {
+    SCOPED_TRACE(::testing::Message() << "min_support " << k);
+    expect_support_matches_columns<float>(k);
+  }
+}
+
+TEST(KernelTest, uint16IncrementalMatchesFull)
+{
+  expect_incremental_matches_full<uint16_t>();
+}
+
+TEST(KernelTest, floatIncrementalMatchesFull)
+{
+  expect_incremental_matches_full<float>();
+}
+
+// A change confined to a single row is picked up once its row is sampled, within INCREMENTAL_SAMPLE_INTERVAL frames
+TEST(KernelTest, incrementalPicksUpRowChange)
+{
+  DepthImageToLaserScan full, incremental;
+  setup(full, 100, 1);
+  setup(incremental, 100, 1);
+  incremental.set_incremental(true, 0, 1000);
+  
+  sensor_msgs::ImagePtr image = make_depth_image<uint16_t>();
+  sensor_msgs::ImageConstPtr limits;
+  incremental.convert_msg(image, make_camera_info(), DepthImageToLaserScan::KERNEL_FUSED, limits);
+  reinterpret_cast<uint16_t*>(image->data.data())[247*WIDTH + 300] = DepthTraits<uint16_t>::fromMeters(0.6);
+  sensor_msgs::LaserScanPtr expected = full.convert_msg(image, make_camera_info(), 
+                                                        DepthImageToLaserScan::KERNEL_FUSED, limits);
+  
+  bool picked_up = false;
+  for(int frame = 0; frame < DepthImageToLaserScan::INCREMENTAL_SAMPLE_INTERVAL && !picked_up; ++frame)
+  {
+    sensor_msgs::LaserScanPtr scan = incremental.convert_msg(image, make_camera_info(), 
+                                                             DepthImageToLaserScan::KERNEL_FUSED, limits);
+    picked_up = std::equal(expected->ranges.begin(), expected->ranges.end(), scan->ranges.begin(), 
+                           [](const float a, const float b) { return a == b || (std::isnan(a) && std::isnan(b)); });
+  }
+  EXPECT_TRUE(picked_up);
+}
+
+// The safety check on the column minima agrees with the returns of the scan
+TEST(KernelTest, uint16SafetyMatchesScan)
+{
+  expect_safety_matches_scan<uint16_t>();
+}
+
+TEST(KernelTest, floatSafetyMatchesScan)
+{
+  expect_safety_matches_scan<float>();
+}
+
+// The compact ranges are the scan's ranges in millimetres, and a decoder following the stream of an encoder gets them
+// back exactly, or to within the tolerance in delta mode
+TEST(KernelTest, compactRoundTrip)
+{
+  const bool deltas[] = {false, true, true};
+  const uint16_t tolerances[] = {0, 0, 5};
+  for(int config = 0; config < 3; ++config)
+  {
+    SCOPED_TRACE(::testing::Message() << "delta " << deltas[config] << ", tolerance " << tolerances[config]);
+    DepthImageToLaserScan dtl;
+    setup(dtl, 100, 1);
+    CompactScanEncoder encoder;
+    encoder.configure(deltas[config], 5, tolerances[config]);
+    CompactScanDecoder decoder;
+    
+    sensor_msgs::ImagePtr image = make_depth_image<uint16_t>();
+    uint16_t* pixels = reinterpret_cast<uint16_t*>(image->data.data());
+    std::vector<uint16_t> decoded;
+    int sent = 0;
+    for(int frame = 0; frame < 12; ++frame)
+    {
+      SCOPED_TRACE(::testing::Message() << "frame " << frame);
+      if(frame % 4 != 3) // Every fourth frame repeats the previous one
+      {
+        for(int v = 200; v < 280; ++v)
+        {
+          for(int u = frame*40; u < frame*40 + 40; ++u)
+          {
+            pixels[v*WIDTH + u] = DepthTraits<uint16_t>::fromMeters(1.0 + 0.001*frame);
+          }
+        }
+      }
+      sensor_msgs::ImageConstPtr limits;
+      sensor_msgs::LaserScanPtr scan = dtl.convert_msg(image, make_camera_info(), 
+                                                       DepthImageToLaserScan::KERNEL_FUSED, limits);
+      std::vector<uint16_t> ranges_mm;
+      dtl.compact_ranges(*scan, ranges_mm);
+      ASSERT_EQ(scan->ranges.size(), ranges_mm.size());
+      for(size_t i = 0; i < ranges_mm.size(); ++i)
+      {
+        ASSERT_EQ(std::isfinite(scan->ranges[i]), ranges_mm[i] != 0) << "beam " << i;
+        if(ranges_mm[i] != 0)
+        {
+          EXPECT_NEAR(scan->ranges[i]*1000, ranges_mm[i], 1.0) << "beam " << i;
+        }
+      }
+      
+      CompactScan compact;
+      if(encoder.encode(*scan, ranges_mm, compact))
+      {
+        ++sent;
+        ASSERT_TRUE(decoder.decode(compact, decoded));
+      }
+      ASSERT_EQ(ranges_mm.size(), decoded.size());
+      int mismatches = 0;
+      for(size_t i = 0; i < ranges_mm.size(); ++i)
+      {
+        mismatches += std::abs(ranges_mm[i] - decoded[i]) > tolerances[config];
+      }
+      EXPECT_EQ(0, mismatches);
+    }
+    EXPECT_EQ(deltas[config] ? 9 : 12, sent); // Nothing changes in the repeated frames
+  }
+}
+
+// A decoder that missed a delta message reports no ranges until the next key frame, and then the encoder's
+TEST(KernelTest, compactResynchronizesOnKeyFrame)
+{
+  DepthImageToLaserScan dtl;
+  setup(dtl, 100, 1);
+  CompactScanEncoder encoder;
+  encoder.configure(true, 4, 0);
+  CompactScanDecoder decoder;
+  
+  sensor_msgs::ImagePtr image = make_depth_image<uint16_t>();
+  uint16_t* pixels = reinterpret_cast<uint16_t*>(image->data.data());
+  bool resynchronized = false;
+  for(int frame = 0; frame < 8; ++frame)
+  {
+    SCOPED_TRACE(::testing::Message() << "frame " << frame);
+    for(int v = 200; v < 280; ++v)
+    {
+      for(int u = frame*40; u < frame*40 + 40; ++u)
+      {
+        pixels[v*WIDTH + u] = DepthTraits<uint16_t>::fromMeters(1.0);
+      }
+    }
+    sensor_msgs::ImageConstPtr limits;
+    sensor_msgs::LaserScanPtr scan = dtl.convert_msg(image, make_camera_info(), 
+                                                     DepthImageToLaserScan::KERNEL_FUSED, limits);
+    std::vector<uint16_t> ranges_mm;
+    dtl.compact_ranges(*scan, ranges_mm);
+    CompactScan compact;
+    ASSERT_TRUE(encoder.encode(*scan, ranges_mm, compact));
+    if(frame == 1)
+    {
+      ASSERT_EQ(CompactScan::DELTA, compact.encoding);
+      continue; // Lost
+    }
+    
+    sensor_msgs::LaserScan decoded;
+    const bool synchronized = decoder.decode(compact, decoded);
+    resynchronized |= frame > 1 && compact.encoding == CompactScan::ABSOLUTE;
+    EXPECT_EQ(frame == 0 || resynchronized, synchronized);
+    if(synchronized)
+    {
+      ASSERT_EQ(ranges_mm.size(), decoded.ranges.size());
+      for(size_t i = 0; i < ranges_mm.size(); ++i)
+      {
+        if(ranges_mm[i] == 0)
+        {
+          EXPECT_TRUE(std::isnan(decoded.ranges[i])) << "beam " << i;
+        }
+        else
+        {
+          EXPECT_FLOAT_EQ(ranges_mm[i]*0.001f, decoded.ranges[i]) << "beam " << i;
+        }
+      }
+    }
+  }
+  EXPECT_TRUE(resynchronized);
+}
+
+// A disparity image gives the scan of the depth image it was computed from, up to the rounding of the depths
+TEST(KernelTest, disparityMatchesDepthImage)
+{
+  const float focal_length = 570.3422241210938;
+  const float baseline = 0.075;
+  sensor_msgs::ImagePtr image = make_depth_image<float>();
+  stereo_msgs::DisparityImagePtr disparity(new stereo_msgs::DisparityImage);
+  disparity->header = image->header;
+  disparity->image = *image;
+  disparity->f = focal_length;
+  disparity->T = baseline;
+  disparity->min_disparity = 0;
+  disparity->max_disparity = focal_length*baseline/RANGE_MIN;
+  const float* depths = reinterpret_cast<const float*>(image->data.data());
+  float* disparities = reinterpret_cast<float*>(disparity->image.data.data());
+  for(int i = 0; i < WIDTH*HEIGHT; ++i)
+  {
+    disparities[i] = (depths[i] > 0) ? focal_length*baseline/depths[i] : -1; // Negative: no match
+  }
+  
+  const int scan_heights[] = {1, 7, 100, HEIGHT - 1};
+  for(int h = 0; h < 4; ++h)
+  {
+    SCOPED_TRACE(::testing::Message() << "scan_height " << scan_heights[h]);
+    sensor_msgs::LaserScanPtr expected = convert(image, DepthImageToLaserScan::KERNEL_FUSED, scan_heights[h], 1);
+    EXPECT_GT(count_returns(*expected), WIDTH/2);
+    
+    DepthImageToLaserScan dtl;
+    setup(dtl, scan_heights[h], 1);
+    sensor_msgs::LaserScanPtr scan = dtl.convert_disparity(disparity, make_camera_info());
+    ASSERT_EQ(expected->ranges.size(), scan->ranges.size());
+    for(size_t i = 0; i < scan->ranges.size(); ++i)
+    {
+      ASSERT_EQ(std::isfinite(expected->ranges[i]), std::isfinite(scan->ranges[i])) << "beam " << i;
+      if(std::isfinite(expected->ranges[i]))
+      {
+        EXPECT_NEAR(expected->ranges[i], scan->ranges[i], 1e-5*expected->ranges[i]) << "beam " << i;
+      }
+    }
+  }
+}
+
+TEST(KernelTest, uint16RotationMatchesUpright)
+{
+  expect_rotation_matches_upright<uint16_t>();
+}
+
+TEST(KernelTest, floatRotationMatchesUpright)
+{
+  expect_rotation_matches_upright<float>();
+}
+
+// Readers get back every scan still in the ring, and the latest one, as written
+TEST(KernelTest, shmWriteRead)
+{
+  const std::string name = "/kernel_test_shm_" + std::to_string(getpid());
+  const uint32_t num_slots = 4;
+  ScanShmWriter writer;
+  writer.open(name, num_slots, WIDTH);
+  ScanShmReader reader;
+  reader.open(name);
+  
+  ShmScanInfo info;
+  std::vector<float> ranges;
+  EXPECT_FALSE(reader.read_latest(info, ranges));
+  
+  std::vector<float> scan(WIDTH + 10);
+  for(uint32_t n = 0; n < 10; ++n)
+  {
+    for(size_t i = 0; i < scan.size(); ++i)
+    {
+      scan[i] = n + 0.001*i;
+    }
+    ShmScanInfo written;
+    memset(&written, 0, sizeof(written));
+    written.seq = n;
+    written.stamp = 1000000000ull*n;
+    written.angle_min = -0.5;
+    strcpy(written.frame_id, "camera_depth_frame");
+    writer.write(written, scan.data(), n == 9 ? scan.size() : WIDTH - n); // The last scan is too long for a slot
+  }
+  EXPECT_EQ(10u, reader.written());
+  
+  ASSERT_TRUE(reader.read_latest(info, ranges));
+  EXPECT_EQ(9u, info.index);
+  EXPECT_EQ(9u, info.seq);
+  EXPECT_EQ(9000000000ull, info.stamp);
+  EXPECT_EQ(-0.5, info.angle_min);
+  EXPECT_STREQ("camera_depth_frame", info.frame_id);
+  ASSERT_EQ((uint32_t)WIDTH, info.num_beams);
+  ASSERT_EQ((size_t)WIDTH, ranges.size());
+  EXPECT_TRUE(std::equal(ranges.begin(), ranges.end(), scan.begin()));
+  
+  for(uint64_t index = 0; index < 10; ++index)
+  {
+    SCOPED_TRACE(::testing::Message() << "index " << index);
+    const bool in_ring = index + num_slots >= 10;
+    ASSERT_EQ(in_ring, reader.read(index, info, ranges));
+    if(in_ring && index < 9)
+    {
+      EXPECT_EQ(index, info.index);
+      ASSERT_EQ(WIDTH - index, ranges.size());
+      for(size_t i = 0; i < ranges.size(); ++i)
+      {
+        ASSERT_EQ((float)(index + 0.001*i), ranges[i]) << "beam " << i;
+      }
+    }
+  }
+  EXPECT_FALSE(reader.read(10, info, ranges));
+  
+  writer.close();
+  reader.close();
+  shm_unlink(name.c_str());
+}
+
+// Reopening a ring with the same layout keeps its readers and scans; another layout closes it for them
+TEST(KernelTest, shmReopen)
+{
+  const std::string name = "/kernel_test_shm_" + std::to_string(getpid());
+  ScanShmWriter writer;
+  writer.open(name, 4, WIDTH);
+  ScanShmReader reader;
+  reader.open(name);
+  std::vector<float> scan(WIDTH, 1.0);
+  ShmScanInfo info;
+  memset(&info, 0, sizeof(info));
+  writer.write(info, scan.data(), scan.size());
+  
+  writer.close();
+  EXPECT_TRUE(reader.closed());
+  writer.open(name, 4, WIDTH);
+  EXPECT_FALSE(reader.closed());
+  EXPECT_EQ(1u, reader.written());
+  writer.write(info, scan.data(), scan.size());
+  EXPECT_EQ(2u, reader.written());
+  
+  writer.open(name, 4, 2*WIDTH);
+  EXPECT_TRUE(reader.closed());
+  reader.open(name);
+  EXPECT_FALSE(reader.closed());
+  EXPECT_EQ(0u, reader.written());
+  
+  writer.close();
+  reader.close();
+  shm_unlink(name.c_str());
+}
+
+// A reader racing the writer never gets a scan mixing two writes
+TEST(KernelTest, shmNoTornReads)
+{
+  const std::string name = "/kernel_test_shm_" + std::to_string(getpid());
+  ScanShmWriter writer;
+  writer.open(name, 2, WIDTH);
+  ScanShmReader reader;
+  reader.open(name);
+  
+  bool stop = false;
+  boost::mutex mutex;
+  int reads = 0, torn = 0;
+  boost::thread racer([&]() {
+    ShmScanInfo info;
+    std::vector<float> ranges;
+    for(;;)
+    {
+      {
+        boost::mutex::scoped_lock lock(mutex);
+        if(stop)
+        {
+          return;
+        }
+      }
+      if(reader.read_latest(info, ranges))
+      {
+        bool consistent = ranges.size() == WIDTH;
+        for(size_t i = 0; i < ranges.size() && consistent; ++i)
+        {
+          consistent = ranges[i] == (float)info.seq;
+        }
+        boost::mutex::scoped_lock lock(mutex);
+        ++reads;
+        torn += !consistent;
+      }
+    }
+  });
+  
+  std::vector<float> scan(WIDTH);
+  ShmScanInfo info;
+  memset(&info, 0, sizeof(info));
+  bool raced = false; // Keep writing until the reader has had a chance to run
+  for(uint32_t n = 0; n < 20000 || !raced; ++n)
+  {
+    std::fill(scan.begin(), scan.end(), (float)n);
+    info.seq = n;
+    writer.write(info, scan.data(), scan.size());
+    if(n % 1000 == 0)
+    {
+      boost::this_thread::yield();
+      boost::mutex::scoped_lock lock(mutex);
+      raced = reads > 100;
+    }
+  }
+  {
+    boost::mutex::scoped_lock lock(mutex);
+    stop = true;
+  }
+  racer.join();
+  EXPECT_EQ(0, torn);
+  
+  writer.close();
+  reader.close();
+  shm_unlink(name.c_str());
+}
+
+TEST(KernelTest, uint16PooledMatchesPlain)
+{
+  expect_pooled_matches_plain<uint16_t>();
+}
+
+TEST(KernelTest, floatPooledMatchesPlain)
+{
+  expect_pooled_matches_plain<float>();
+}
+
+TEST(KernelTest, uint16KernelsAgree)
+{
+  expect_kernels_agree<uint16_t>();
+}
+
+TEST(KernelTest, floatKernelsAgree)
+{
+  expect_kernels_agree<float>();
+}
+
+// The quantized reduction only picks the nearest pixel to within one code (see set_quantize), and reports the exact
+// range of the pixel it picked
+TEST(KernelTest, quantizedWithinOneCode)
+{
+  sensor_msgs::ImagePtr image = make_depth_image<float>();
+  const float max_error = 1.03; // One code with the default range limits is about 2% of the depth
+  for(int approach = DepthImageToLaserScan::KERNEL_HALVING; approach <= DepthImageToLaserScan::KERNEL_THREADED; 
+      ++approach)
+  {
+    SCOPED_TRACE(::testing::Message() << "kernel " << DepthImageToLaserScan::kernel_name(approach));
+    sensor_msgs::LaserScanPtr exact = convert(image, approach, 100, 1);
+    sensor_msgs::LaserScanPtr quantized = convert(image, approach, 100, 1, true);
+    EXPECT_GT(count_returns(*exact), WIDTH/2);
+    ASSERT_EQ(exact->ranges.size(), quantized->ranges.size());
+    for(size_t i = 0; i < exact->ranges.size(); ++i)
+    {
+      ASSERT_EQ(std::isfinite(exact->ranges[i]), std::isfinite(quantized->ranges[i])) << "beam " << i;
+      if(std::isfinite(exact->ranges[i]))
+      {
+        EXPECT_GE(quantized->ranges[i], exact->ranges[i]) << "beam " << i;
+        EXPECT_LE(quantized->ranges[i], exact->ranges[i]*max_error) << "beam " << i;
+      }
+    }
+  }
+}
+
+// An organized cloud of the image gives the scan of the float image, whether the CameraInfo is given, estimated from
+// the points, or of the wrong size
+TEST(KernelTest, cloudMatchesDepthImage)
+{
+  sensor_msgs::ImagePtr image = make_depth_image<float>();
+  sensor_msgs::CameraInfoPtr info = make_camera_info();
+  sensor_msgs::LaserScanPtr expected = convert(image, DepthImageToLaserScan::KERNEL_FUSED, 100, 1);
+  EXPECT_GT(count_returns(*expected), WIDTH/2);
+  
+  sensor_msgs::CameraInfoPtr wrong_size = make_camera_info();
+  wrong_size->width /= 2;
+  wrong_size->height /= 2;
+  for(int point_step = 4; point_step <= 8; point_step += 4)
+  {
+    SCOPED_TRACE(::testing::Message() << "point_step " << point_step);
+    sensor_msgs::PointCloud2Ptr cloud = make_cloud(*image, *info, point_step);
+    
+    DepthImageToLaserScan with_info, estimated, mismatched;
+    setup(with_info, 100, 1);
+    setup(estimated, 100, 1);
+    setup(mismatched, 100, 1);
+    expect_same_ranges(*expected, *with_info.convert_cloud(cloud, info));
+    
+    // The estimated intrinsics may round a beam differently, but give the same scan to within a millimetre
+    sensor_msgs::LaserScanPtr scan = estimated.convert_cloud(cloud, sensor_msgs::CameraInfoConstPtr());
+    expect_same_ranges(*scan, *mismatched.convert_cloud(cloud, wrong_size));
+    ASSERT_EQ(expected->ranges.size(), scan->ranges.size());
+    for(size_t i = 0; i < scan->ranges.size(); ++i)
+    {
+      if(std::isfinite(expected->ranges[i]) && std::isfinite(scan->ranges[i]))
+      {
+        EXPECT_NEAR(expected->ranges[i], scan->ranges[i], 1e-3) << "beam " << i;
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}